@@ -0,0 +1,46 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+// Opt-in CPU timing of overlay code paths, enabled with OVERLAY_BENCH.
+// Measures wall time on the render thread without glFinish, i.e. the CPU
+// cost of our own code plus the driver work done inside the GL calls.
+// The average is printed every REPORT_FRAMES samples.
+class BenchTimer {
+public:
+    static constexpr int REPORT_FRAMES = 600;
+
+    explicit BenchTimer(const char* label) : label(label) {}
+
+    void begin() { start = std::chrono::steady_clock::now(); }
+    void end() {
+        total_us += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        if (++samples == REPORT_FRAMES) {
+            std::cout << "Overlay bench: " << label << " " << total_us / samples << " us/frame" << std::endl;
+            total_us = 0.0;
+            samples = 0;
+        }
+    }
+
+private:
+    const char* label;
+    std::chrono::steady_clock::time_point start;
+    double total_us = 0.0;
+    int samples = 0;
+};
+
+// Value of OVERLAY_BENCH, or nullptr when benchmarking is off
+inline const char* bench_mode() {
+    static const char* mode = getenv("OVERLAY_BENCH");
+    return mode;
+}
+
+inline bool bench_mode_is(const char* name) {
+    return bench_mode() && strcmp(bench_mode(), name) == 0;
+}
+
+#endif // BENCH_HPP
@@ -0,0 +1,253 @@
+#include "capture.hpp"
+#include "trace_export.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+
+static constexpr auto KEY_POLL_INTERVAL = std::chrono::milliseconds(100);
+
+Capture::~Capture() {
+    if (capturing) stop();
+    if (writer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(writer_mutex);
+            shutting_down = true;
+        }
+        writer_cv.notify_one();
+        writer.join();
+    }
+    delete opened_log.exchange(nullptr);
+}
+
+void Capture::configure(const CaptureSettings& config) {
+    settings = config;
+    if (const char* env = getenv("OVERLAY_CAPTURE_DIR")) settings.dir = env;
+    if (const char* env = getenv("OVERLAY_CAPTURE_DELAY")) settings.delay_s = atof(env);
+    if (const char* env = getenv("OVERLAY_CAPTURE_TRACE")) settings.trace = atoi(env) != 0;
+    if (const char* env = getenv("OVERLAY_CAPTURE_DURATION")) {
+        settings.duration_s = atof(env);
+        settings.autostart = settings.duration_s > 0.0;
+    }
+    configured_at = std::chrono::steady_clock::now();
+    last_key_poll = configured_at;
+    // Started here so starting a capture doesn't spawn a thread mid-game
+    if (!writer.joinable()) writer = std::thread(&Capture::writer_main, this);
+}
+
+void Capture::update(Display* dpy) {
+    auto now = std::chrono::steady_clock::now();
+
+    if (settings.autostart && now - configured_at >= std::chrono::duration<double>(settings.delay_s)) {
+        settings.autostart = false;
+        start();
+    }
+    if (capturing && settings.duration_s > 0.0 &&
+        now - started_at >= std::chrono::duration<double>(settings.duration_s)) {
+        stop();
+    }
+
+    // XQueryKeymap is a round trip, so only poll the hotkey a few times a second
+    if (now - last_key_poll >= KEY_POLL_INTERVAL) {
+        last_key_poll = now;
+        bool down = poll_hotkey(dpy);
+        if (down && !key_was_down) {
+            if (capturing) stop(); else start();
+        }
+        key_was_down = down;
+    }
+}
+
+bool Capture::poll_hotkey(Display* dpy) {
+    if (keycode < 0) {
+        KeySym sym = XStringToKeysym(settings.key.c_str());
+        keycode = sym == NoSymbol ? 0 : XKeysymToKeycode(dpy, sym);
+        if (keycode == 0) std::cerr << "Overlay Error: Unknown capture_key '" << settings.key << "'" << std::endl;
+    }
+    if (keycode == 0) return false;
+    char keys[32];
+    XQueryKeymap(dpy, keys);
+    return keys[keycode / 8] & (1 << (keycode % 8));
+}
+
+void Capture::start() {
+    if (capturing) return;
+    if (writer_busy) {
+        std::cerr << "Overlay: Previous capture is still being written, not starting a new one" << std::endl;
+        return;
+    }
+
+    char stamp[32];
+    time_t now = time(nullptr);
+    strftime(stamp, sizeof(stamp), "%Y%m%d-%H%M%S", localtime(&now));
+    log_base = settings.dir + "/overlay_capture_" + stamp;
+
+    // Creating, preallocating and mapping the file would stall this frame
+    writer_busy = true;
+    open_failed = false;
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        opening_base = log_base;
+        open_cancelled = false;
+    }
+    writer_cv.notify_one();
+    capturing = true;
+    started_at = std::chrono::steady_clock::now();
+}
+
+void Capture::stop() {
+    if (!capturing) return;
+    capturing = false;
+    // Closing the log joins its flush thread, so leave that to the writer
+    {
+        std::lock_guard<std::mutex> lock(writer_mutex);
+        if (log) {
+            finishing_log = std::move(log);
+            finishing_base = log_base;
+        } else if (TelemetryLog* opened = opened_log.exchange(nullptr, std::memory_order_acquire)) {
+            // Opened, but record() hasn't picked it up yet
+            finishing_log.reset(opened);
+            finishing_base = log_base;
+        } else {
+            open_cancelled = true; // The writer finishes it as soon as it is open
+        }
+    }
+    writer_cv.notify_one();
+}
+
+void Capture::record(const FrameRecord& frame, const SystemSample& sample, bool stutter) {
+    if (!capturing) return;
+    if (!log) {
+        if (TelemetryLog* opened = opened_log.exchange(nullptr, std::memory_order_acquire)) {
+            log.reset(opened);
+            samples_logged = false;
+            started_at = std::chrono::steady_clock::now();
+            std::cout << "Overlay: Capture started" << std::endl;
+        } else {
+            if (open_failed.exchange(false)) capturing = false;
+            return;
+        }
+    }
+    for (uint16_t id = 0; id < METRIC_COUNT; id++) {
+        float value = metric_value(sample, (MetricId)id);
+        if (!samples_logged || value != metric_value(last_logged, (MetricId)id)) {
+            log->append_sample(frame.timestamp_ns, id, value);
+        }
+    }
+    last_logged = sample;
+    samples_logged = true;
+    log->append_frame(frame, stutter ? (uint32_t)FRAME_FLAG_STUTTER : 0u);
+}
+
+// --- Summary helpers ---
+static float percentile(const std::vector<float>& sorted, double p) {
+    if (sorted.empty()) return 0.0f;
+    size_t index = std::min(sorted.size() - 1, (size_t)(p * sorted.size()));
+    return sorted[index];
+}
+
+// Average FPS over the slowest `fraction` of frames ("1% low" and friends)
+static double low_fps(const std::vector<float>& sorted, double fraction) {
+    if (sorted.empty()) return 0.0;
+    size_t count = std::max<size_t>(1, (size_t)(sorted.size() * fraction));
+    double total_ms = 0.0;
+    for (size_t i = sorted.size() - count; i < sorted.size(); i++) total_ms += sorted[i];
+    return total_ms > 0.0 ? 1000.0 * count / total_ms : 0.0;
+}
+
+void Capture::writer_main() {
+    std::unique_lock<std::mutex> lock(writer_mutex);
+    while (true) {
+        writer_cv.wait(lock, [this] { return shutting_down || finishing_log || !opening_base.empty(); });
+        if (!opening_base.empty()) {
+            std::string base = std::move(opening_base);
+            opening_base.clear();
+            lock.unlock();
+            auto opened = std::make_unique<TelemetryLog>();
+            bool ok = opened->open(base + ".bin");
+            lock.lock();
+            if (!ok) {
+                writer_busy = false;
+                open_failed = true;
+            } else if (open_cancelled) {
+                finishing_log = std::move(opened);
+                finishing_base = base;
+            } else {
+                opened_log.store(opened.release(), std::memory_order_release);
+            }
+            continue;
+        }
+        if (!finishing_log) return;
+        std::unique_ptr<TelemetryLog> finished = std::move(finishing_log);
+        std::string base = std::move(finishing_base);
+        lock.unlock();
+
+        size_t dropped = finished->dropped();
+        finished->close();
+        finished.reset();
+
+        // Stream the log back; only the frametimes are kept for the percentiles
+        std::string log_path = base + ".bin";
+        TelemetryReader reader;
+        if (!reader.open(log_path)) std::cerr << "Overlay Error: Could not read back capture " << log_path << std::endl;
+
+        std::vector<float> frametimes;
+        double app_cpu_total = 0.0, present_wait_total = 0.0, gpu_total = 0.0, cpu_usage_total = 0.0;
+        float cpu_usage = 0.0f;
+        size_t stutters = 0;
+        uint64_t first_ns = 0, last_ns = 0;
+        TelemetryReader::Record record;
+        while (reader.next(record)) {
+            if (record.type == RECORD_SAMPLE) {
+                if (record.sample.metric == METRIC_CPU_USAGE) cpu_usage = record.sample.value;
+                continue;
+            }
+            const FrameRecord& f = record.frame.frame;
+            if (frametimes.empty()) first_ns = f.timestamp_ns;
+            last_ns = f.timestamp_ns;
+            frametimes.push_back(f.frame_ms);
+            app_cpu_total += f.app_cpu_ms;
+            present_wait_total += f.present_wait_ms;
+            gpu_total += f.gpu_ms;
+            cpu_usage_total += cpu_usage;
+            stutters += (record.frame.flags & FRAME_FLAG_STUTTER) != 0;
+        }
+
+        // --- Summary report ---
+        size_t n = frametimes.size();
+        std::sort(frametimes.begin(), frametimes.end());
+        double frametime_total = 0.0;
+        for (float ms : frametimes) frametime_total += ms;
+        std::string summary_path = base + "_summary.txt";
+        FILE* summary = fopen(summary_path.c_str(), "w");
+        if (summary) {
+            fprintf(summary, "frames = %zu\n", n);
+            fprintf(summary, "dropped_records = %zu\n", dropped);
+            fprintf(summary, "duration_s = %.3f\n", n ? (last_ns - first_ns) / 1e9 : 0.0);
+            fprintf(summary, "fps_avg = %.2f\n", frametime_total > 0.0 ? 1000.0 * n / frametime_total : 0.0);
+            fprintf(summary, "fps_1pct_low = %.2f\n", low_fps(frametimes, 0.01));
+            fprintf(summary, "fps_0.1pct_low = %.2f\n", low_fps(frametimes, 0.001));
+            fprintf(summary, "frametime_avg_ms = %.3f\n", n ? frametime_total / n : 0.0);
+            fprintf(summary, "frametime_p50_ms = %.3f\n", percentile(frametimes, 0.50));
+            fprintf(summary, "frametime_p90_ms = %.3f\n", percentile(frametimes, 0.90));
+            fprintf(summary, "frametime_p95_ms = %.3f\n", percentile(frametimes, 0.95));
+            fprintf(summary, "frametime_p99_ms = %.3f\n", percentile(frametimes, 0.99));
+            fprintf(summary, "frametime_p99.9_ms = %.3f\n", percentile(frametimes, 0.999));
+            fprintf(summary, "frametime_max_ms = %.3f\n", n ? frametimes.back() : 0.0f);
+            fprintf(summary, "stutters = %zu\n", stutters);
+            fprintf(summary, "app_cpu_avg_ms = %.3f\n", n ? app_cpu_total / n : 0.0);
+            fprintf(summary, "present_wait_avg_ms = %.3f\n", n ? present_wait_total / n : 0.0);
+            fprintf(summary, "gpu_avg_ms = %.3f\n", n ? gpu_total / n : 0.0);
+            fprintf(summary, "cpu_usage_avg = %.1f\n", n ? cpu_usage_total / n : 0.0);
+            fclose(summary);
+            std::cout << "Overlay: Capture of " << n << " frames written to " << log_path << " and " << summary_path << std::endl;
+        } else {
+            std::cerr << "Overlay Error: Could not create capture summary " << summary_path << std::endl;
+        }
+        if (settings.trace) export_chrome_trace(log_path, base + ".json");
+
+        writer_busy = false;
+        lock.lock();
+    }
+}
@@ -0,0 +1,79 @@
+#ifndef CAPTURE_HPP
+#define CAPTURE_HPP
+
+#include <X11/Xlib.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stats.hpp"
+#include "telemetry_log.hpp"
+
+// --- Settings for benchmark capture mode ---
+// Config keys: capture_key, capture_duration, capture_delay, capture_dir, capture_trace.
+// Environment overrides: OVERLAY_CAPTURE_DURATION, OVERLAY_CAPTURE_DELAY, OVERLAY_CAPTURE_DIR,
+// OVERLAY_CAPTURE_TRACE.
+// Setting a duration through the environment starts a capture automatically.
+struct CaptureSettings {
+    std::string key = "F11";       // X keysym name that toggles capture
+    double duration_s = 0.0;       // 0 = until toggled off
+    double delay_s = 0.0;          // Delay before an automatic capture starts
+    bool autostart = false;
+    std::string dir = "/tmp";
+    bool trace = false;            // Also export Chrome trace JSON when a capture stops
+};
+
+// Records every frame while active. The render thread only appends to a
+// memory-mapped TelemetryLog. A writer thread opens the log when a capture
+// starts (recording begins once it is mapped) and, once the capture stops,
+// closes it and streams it back to write the summary report.
+class Capture {
+public:
+    ~Capture();
+
+    void configure(const CaptureSettings& settings);
+    // Called once per frame from the swap hook
+    void update(Display* dpy);
+    void record(const FrameRecord& frame, const SystemSample& sample, bool stutter);
+
+    void start();
+    void stop();
+    bool active() const { return capturing; }
+
+private:
+    void writer_main();
+    bool poll_hotkey(Display* dpy);
+
+    CaptureSettings settings;
+    bool capturing = false;   // Requested; frames are recorded once `log` arrives
+    std::chrono::steady_clock::time_point configured_at;
+    std::chrono::steady_clock::time_point started_at;
+    std::chrono::steady_clock::time_point last_key_poll;
+    bool key_was_down = false;
+    int keycode = -1;
+
+    std::unique_ptr<TelemetryLog> log;
+    std::string log_base;     // Output path without extension
+    SystemSample last_logged; // Samples are only logged when a collector value changes
+    bool samples_logged = false;
+
+    // Writer thread state
+    std::thread writer;
+    std::mutex writer_mutex;
+    std::condition_variable writer_cv;
+    std::string opening_base;  // Log the writer should open, empty if none
+    bool open_cancelled = false; // Stopped before the opened log was handed over
+    std::atomic<TelemetryLog*> opened_log{nullptr}; // Opened by the writer, picked up by record()
+    std::atomic<bool> open_failed{false};
+    std::unique_ptr<TelemetryLog> finishing_log; // Handed over on stop
+    std::string finishing_base;
+    std::atomic<bool> writer_busy{false}; // A capture is open or still being finalized
+    bool shutting_down = false;
+};
+
+#endif // CAPTURE_HPP
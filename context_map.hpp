@@ -0,0 +1,82 @@
+#ifndef CONTEXT_MAP_HPP
+#define CONTEXT_MAP_HPP
+
+#include <GL/glx.h>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Fixed-size open-addressed map from GLX contexts to per-context data, looked
+// up on every swap without a lock. A slot is claimed with a CAS on its key and
+// never moves; erasing resets the value and leaves a tombstone that a later
+// insert can claim. Values themselves aren't synchronized: an entry is only
+// used by the thread that has its context current, or by whoever created the
+// context before handing it out, which is all GLX allows anyway.
+template <typename T, size_t Capacity>
+class ContextMap {
+    static_assert((Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+public:
+    // The entry for `context`, or nullptr
+    T* find(GLXContext context) {
+        size_t slot = find_slot((uintptr_t)context);
+        return slot < Capacity ? &values[slot] : nullptr;
+    }
+
+    // The entry for `context`, default-constructed if it is new; nullptr if the map is full
+    T* insert(GLXContext context) {
+        uintptr_t key = (uintptr_t)context;
+        size_t slot = find_slot(key);
+        if (slot < Capacity) return &values[slot];
+        slot = hash(key);
+        for (size_t probe = 0; probe < Capacity; ++probe, slot = (slot + 1) & (Capacity - 1)) {
+            uintptr_t k = keys[slot].load(std::memory_order_relaxed);
+            while (k == EMPTY || k == TOMBSTONE) {
+                if (keys[slot].compare_exchange_weak(k, key, std::memory_order_acq_rel)) return &values[slot];
+            }
+        }
+        return nullptr;
+    }
+
+    void erase(GLXContext context) {
+        size_t slot = find_slot((uintptr_t)context);
+        if (slot == Capacity) return;
+        values[slot] = T{};
+        keys[slot].store(TOMBSTONE, std::memory_order_release);
+    }
+
+    // Calls f(context, value) for every entry
+    template <typename F>
+    void for_each(F f) {
+        for (size_t slot = 0; slot < Capacity; ++slot) {
+            uintptr_t k = keys[slot].load(std::memory_order_acquire);
+            if (k != EMPTY && k != TOMBSTONE) f((GLXContext)k, values[slot]);
+        }
+    }
+
+private:
+    // Context handles are pointers, so neither is ever a key
+    static constexpr uintptr_t EMPTY = 0;
+    static constexpr uintptr_t TOMBSTONE = 1;
+
+    static size_t hash(uintptr_t key) {
+        // Allocations are aligned; drop the low bits and mix the rest
+        return (size_t)(((uint64_t)(key >> 4) * 0x9E3779B97F4A7C15ull) >> 32) & (Capacity - 1);
+    }
+
+    // Slot holding `key`, or Capacity. Probing stops at the first never-used slot.
+    size_t find_slot(uintptr_t key) const {
+        size_t slot = hash(key);
+        for (size_t probe = 0; probe < Capacity; ++probe, slot = (slot + 1) & (Capacity - 1)) {
+            uintptr_t k = keys[slot].load(std::memory_order_acquire);
+            if (k == key) return slot;
+            if (k == EMPTY) break;
+        }
+        return Capacity;
+    }
+
+    std::atomic<uintptr_t> keys[Capacity] = {};
+    T values[Capacity] = {};
+};
+
+#endif // CONTEXT_MAP_HPP
@@ -0,0 +1,25 @@
+#include "embedded_assets.hpp"
+
+// --- Font, pulled in by the assembler ---
+// .incbin paths are relative to the directory the compiler runs in, which is
+// the source directory like the rest of the build. The size is computed by
+// the assembler too, so it always matches the file that was embedded.
+__asm__(
+    ".section .rodata\n"
+    ".balign 16\n"
+    ".globl overlay_embedded_font\n"
+    ".hidden overlay_embedded_font\n"
+    ".type overlay_embedded_font, @object\n"
+    "overlay_embedded_font:\n"
+    ".incbin \"DejaVuSans.ttf\"\n"
+    ".Loverlay_embedded_font_end:\n"
+    ".size overlay_embedded_font, .Loverlay_embedded_font_end - overlay_embedded_font\n"
+    ".balign 8\n"
+    ".globl overlay_embedded_font_size\n"
+    ".hidden overlay_embedded_font_size\n"
+    ".type overlay_embedded_font_size, @object\n"
+    "overlay_embedded_font_size:\n"
+    ".quad .Loverlay_embedded_font_end - overlay_embedded_font\n"
+    ".size overlay_embedded_font_size, 8\n"
+    ".previous\n"
+);
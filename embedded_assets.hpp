@@ -0,0 +1,13 @@
+#ifndef EMBEDDED_ASSETS_HPP
+#define EMBEDDED_ASSETS_HPP
+
+#include <cstddef>
+
+// Files compiled into liboverlay.so, so deployment is the one library.
+// They live in read-only data for the lifetime of the process.
+
+// DejaVuSans.ttf, the default overlay font
+extern "C" const unsigned char overlay_embedded_font[];
+extern "C" const size_t overlay_embedded_font_size;
+
+#endif // EMBEDDED_ASSETS_HPP
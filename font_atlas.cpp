@@ -0,0 +1,368 @@
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "font_atlas.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// --- On-disk cache layout ---
+// Header, glyph table, skyline, then the SIZE x SIZE bitmap
+static constexpr char CACHE_MAGIC[4] = {'O', 'V', 'F', 'A'};
+static constexpr uint32_t CACHE_VERSION = 1;
+
+struct AtlasCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint64_t key;           // Font hash and atlas parameters, see cache_key()
+    uint32_t size;
+    uint32_t glyph_count;
+    uint32_t skyline_count;
+    uint32_t reserved;
+};
+
+struct AtlasCacheGlyph {
+    uint32_t codepoint;
+    AtlasGlyph glyph;
+};
+
+bool FontAtlas::build(std::vector<unsigned char> font_file, const std::string& cache_dir) {
+    // stb_truetype reads the file lazily, so the atlas keeps it
+    font_storage = std::move(font_file);
+    return build(font_storage.data(), font_storage.size(), cache_dir);
+}
+
+bool FontAtlas::build(const unsigned char* font_file, size_t size, const std::string& cache_dir) {
+    if (font_file != font_storage.data()) font_storage.clear();
+    font_data = font_file;
+    font_size = size;
+    if (!font_data || font_size == 0 || !stbtt_InitFont(&font, font_data, stbtt_GetFontOffsetForIndex(font_data, 0))) {
+        std::cerr << "Overlay Error: Could not parse font" << std::endl;
+        return false;
+    }
+    scale = stbtt_ScaleForPixelHeight(&font, PIXEL_HEIGHT);
+    int ascent, descent, line_gap;
+    stbtt_GetFontVMetrics(&font, &ascent, &descent, &line_gap);
+    font_ascent = ascent * scale;
+    font_descent = -descent * scale;
+    digit_width = 0.0f;
+    for (int c = '0'; c <= '9'; ++c) {
+        int advance, lsb;
+        stbtt_GetCodepointHMetrics(&font, c, &advance, &lsb);
+        digit_width = std::max(digit_width, advance * scale);
+    }
+    bitmap.assign(SIZE * SIZE, 0);
+    skyline.assign(1, SkylineNode{0, 0, SIZE});
+    glyphs.clear();
+
+    uint64_t key = cache_key();
+    char name[64];
+    snprintf(name, sizeof(name), "/atlas_%016llx.bin", (unsigned long long)key);
+    std::string cache_path = cache_dir.empty() ? std::string() : cache_dir + name;
+    cache_hit = !cache_path.empty() && load_cache(cache_path, key);
+    if (cache_hit) return true;
+
+    // Nearly all overlay text is ASCII; have it ready before the first frame
+    for (uint32_t c = FIRST_CHAR; c < FIRST_CHAR + CHAR_COUNT; ++c) glyph(c);
+    if (!cache_path.empty()) save_cache(cache_path, key);
+    return true;
+}
+
+// FNV-1a over the font file, then over everything that shapes the atlas
+uint64_t FontAtlas::cache_key() const {
+    uint64_t hash = 0xcbf29ce484222325ull;
+    auto mix = [&hash](const void* data, size_t size) {
+        const unsigned char* p = (const unsigned char*)data;
+        for (size_t i = 0; i < size; ++i) hash = (hash ^ p[i]) * 0x100000001b3ull;
+    };
+    mix(font_data, font_size);
+    const float params[] = { (float)SIZE, PIXEL_HEIGHT, (float)PADDING, (float)ON_EDGE,
+                             (float)FIRST_CHAR, (float)CHAR_COUNT, (float)CACHE_VERSION };
+    mix(params, sizeof(params));
+    return hash;
+}
+
+bool FontAtlas::load_cache(const std::string& path, uint64_t key) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(AtlasCacheHeader)) {
+        map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    ::close(fd);
+    if (map == MAP_FAILED) return false;
+
+    const unsigned char* data = (const unsigned char*)map;
+    AtlasCacheHeader header;
+    memcpy(&header, data, sizeof(header));
+    size_t expected = sizeof(AtlasCacheHeader) + header.glyph_count * sizeof(AtlasCacheGlyph) +
+                      header.skyline_count * sizeof(SkylineNode) + (size_t)SIZE * SIZE;
+    bool valid = memcmp(header.magic, CACHE_MAGIC, 4) == 0 && header.version == CACHE_VERSION &&
+                 header.key == key && header.size == SIZE && header.skyline_count > 0 &&
+                 (size_t)st.st_size == expected;
+    const unsigned char* p = data + sizeof(AtlasCacheHeader);
+    const AtlasCacheGlyph* table = (const AtlasCacheGlyph*)p;
+    const SkylineNode* nodes = (const SkylineNode*)(p + header.glyph_count * sizeof(AtlasCacheGlyph));
+    // A stale or corrupt file can pass the size check; every rectangle is
+    // copied out of (and later packed into) the bitmap, so all must fit in it
+    for (uint32_t i = 0; valid && i < header.glyph_count; ++i) {
+        const AtlasGlyph& g = table[i].glyph;
+        valid = g.x + g.w <= SIZE && g.y + g.h <= SIZE;
+    }
+    for (uint32_t i = 0; valid && i < header.skyline_count; ++i) {
+        const SkylineNode& node = nodes[i];
+        valid = node.x >= 0 && node.y >= 0 && node.width >= 0 && node.x <= SIZE - node.width && node.y <= SIZE;
+    }
+    if (!valid && memcmp(header.magic, CACHE_MAGIC, 4) == 0 && header.key == key) {
+        std::cerr << "Overlay Error: Ignoring damaged font atlas cache " << path << std::endl;
+    }
+    if (valid) {
+        skyline.assign(nodes, nodes + header.skyline_count);
+        p = (const unsigned char*)(nodes + header.skyline_count);
+        memcpy(bitmap.data(), p, (size_t)SIZE * SIZE);
+
+        // The per-glyph copies used for repacking come straight out of the bitmap
+        for (uint32_t i = 0; i < header.glyph_count; ++i) {
+            Entry& entry = glyphs[table[i].codepoint];
+            entry.glyph = table[i].glyph;
+            const AtlasGlyph& g = entry.glyph;
+            entry.sdf.resize(g.w * g.h);
+            for (int row = 0; row < g.h; ++row) {
+                memcpy(&entry.sdf[row * g.w], &bitmap[(g.y + row) * SIZE + g.x], g.w);
+            }
+        }
+    }
+    munmap(map, st.st_size);
+    return valid;
+}
+
+void FontAtlas::save_cache(const std::string& path, uint64_t key) const {
+    AtlasCacheHeader header;
+    memcpy(header.magic, CACHE_MAGIC, 4);
+    header.version = CACHE_VERSION;
+    header.key = key;
+    header.size = SIZE;
+    header.glyph_count = glyphs.size();
+    header.skyline_count = skyline.size();
+    header.reserved = 0;
+
+    std::vector<AtlasCacheGlyph> table;
+    for (const auto& it : glyphs) table.push_back(AtlasCacheGlyph{it.first, it.second.glyph});
+
+    // Written under a temporary name and renamed, so a concurrent launch never maps half a file
+    std::string tmp_path = path + ".tmp" + std::to_string(getpid());
+    FILE* file = fopen(tmp_path.c_str(), "wb");
+    if (!file) return;
+    bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+              fwrite(table.data(), sizeof(AtlasCacheGlyph), table.size(), file) == table.size() &&
+              fwrite(skyline.data(), sizeof(SkylineNode), skyline.size(), file) == skyline.size() &&
+              fwrite(bitmap.data(), 1, bitmap.size(), file) == bitmap.size();
+    ok = fclose(file) == 0 && ok;
+    if (!ok || rename(tmp_path.c_str(), path.c_str()) != 0) {
+        unlink(tmp_path.c_str());
+        std::cerr << "Overlay Error: Could not write font atlas cache " << path << std::endl;
+    }
+}
+
+bool FontAtlas::rasterize(uint32_t codepoint, Entry& entry) {
+    // Glyph 0 is the font's missing-glyph box, which beats dropping the character
+    int index = stbtt_FindGlyphIndex(&font, codepoint);
+    int advance, lsb;
+    stbtt_GetGlyphHMetrics(&font, index, &advance, &lsb);
+    entry.glyph = AtlasGlyph{};
+    entry.glyph.advance = advance * scale;
+
+    // Distance values fall off by ON_EDGE over PADDING texels, so the field
+    // reaches zero right at the edge of each glyph's cell
+    float dist_scale = (float)ON_EDGE / PADDING;
+    int w = 0, h = 0, xoff = 0, yoff = 0;
+    unsigned char* sdf = stbtt_GetGlyphSDF(&font, scale, index, PADDING, ON_EDGE, dist_scale, &w, &h, &xoff, &yoff);
+    if (!sdf) return true; // Blank glyphs (space) only advance
+    if (w + 1 > SIZE || h + 1 > SIZE) {
+        stbtt_FreeSDF(sdf, nullptr);
+        return false;
+    }
+    entry.sdf.assign(sdf, sdf + w * h);
+    stbtt_FreeSDF(sdf, nullptr);
+    entry.glyph.w = w;
+    entry.glyph.h = h;
+    entry.glyph.xoff = xoff;
+    entry.glyph.yoff = yoff;
+    return true;
+}
+
+// --- Skyline packing ---
+// The skyline is the top edge of everything packed so far, as a list of
+// horizontal segments covering the full width. A rectangle goes where it
+// rests lowest (bottom-left rule), preferring the narrowest segment on ties.
+bool FontAtlas::pack(int w, int h, int& out_x, int& out_y) {
+    int best = -1, best_y = SIZE, best_width = SIZE + 1;
+    for (size_t i = 0; i < skyline.size(); ++i) {
+        int x = skyline[i].x;
+        if (x + w > SIZE) break;
+        // It rests on the highest segment it spans
+        int y = 0, remaining = w;
+        for (size_t j = i; remaining > 0; ++j) {
+            y = std::max(y, skyline[j].y);
+            remaining -= skyline[j].width;
+        }
+        if (y + h > SIZE) continue;
+        if (y < best_y || (y == best_y && skyline[i].width < best_width)) {
+            best = (int)i;
+            best_y = y;
+            best_width = skyline[i].width;
+        }
+    }
+    if (best < 0) return false;
+
+    out_x = skyline[best].x;
+    out_y = best_y;
+    skyline.insert(skyline.begin() + best, SkylineNode{out_x, best_y + h, w});
+    // Trim the segments the new one now covers
+    for (size_t i = best + 1; i < skyline.size();) {
+        const SkylineNode& prev = skyline[i - 1];
+        SkylineNode& node = skyline[i];
+        int overlap = prev.x + prev.width - node.x;
+        if (overlap <= 0) break;
+        node.x += overlap;
+        node.width -= overlap;
+        if (node.width > 0) break;
+        skyline.erase(skyline.begin() + i);
+    }
+    for (size_t i = 0; i + 1 < skyline.size();) {
+        if (skyline[i].y == skyline[i + 1].y) {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        } else {
+            ++i;
+        }
+    }
+    return true;
+}
+
+void FontAtlas::blit(const Entry& entry) {
+    const AtlasGlyph& g = entry.glyph;
+    for (int row = 0; row < g.h; ++row) {
+        memcpy(&bitmap[(g.y + row) * SIZE + g.x], &entry.sdf[row * g.w], g.w);
+    }
+    mark_dirty(g.x, g.y, g.x + g.w, g.y + g.h);
+}
+
+bool FontAtlas::place(Entry& entry) {
+    if (entry.glyph.w == 0) return true;
+    int x, y;
+    // One texel of gap keeps bilinear filtering from bleeding between neighbours
+    if (!pack(entry.glyph.w + 1, entry.glyph.h + 1, x, y)) return false;
+    entry.glyph.x = x;
+    entry.glyph.y = y;
+    blit(entry);
+    return true;
+}
+
+void FontAtlas::evict_and_repack() {
+    // Drop the older half of the glyphs not used by the current layout pass
+    std::vector<std::pair<uint64_t, uint32_t>> by_age;
+    for (const auto& it : glyphs) {
+        if (it.second.last_used != clock) by_age.emplace_back(it.second.last_used, it.first);
+    }
+    std::sort(by_age.begin(), by_age.end());
+    size_t evict = (by_age.size() + 1) / 2;
+    for (size_t i = 0; i < evict; ++i) glyphs.erase(by_age[i].second);
+
+    // Repack the survivors from their CPU copies, tallest first for a flatter skyline
+    std::vector<std::pair<int, uint32_t>> by_height;
+    for (const auto& it : glyphs) by_height.emplace_back(-(int)it.second.glyph.h, it.first);
+    std::sort(by_height.begin(), by_height.end());
+    skyline.assign(1, SkylineNode{0, 0, SIZE});
+    std::fill(bitmap.begin(), bitmap.end(), 0);
+    for (const auto& it : by_height) {
+        if (!place(glyphs[it.second])) glyphs.erase(it.second);
+    }
+    mark_dirty(0, 0, SIZE, SIZE);
+    ++atlas_generation;
+    std::cout << "Overlay: Font atlas full, evicted " << evict << " glyphs" << std::endl;
+}
+
+const AtlasGlyph* FontAtlas::glyph(uint32_t codepoint) {
+    auto it = glyphs.find(codepoint);
+    if (it != glyphs.end()) {
+        it->second.last_used = clock;
+        return &it->second.glyph;
+    }
+
+    Entry entry;
+    if (!rasterize(codepoint, entry)) return nullptr;
+    entry.last_used = clock;
+    if (!place(entry)) {
+        evict_and_repack();
+        if (!place(entry)) return nullptr;
+    }
+    return &glyphs.emplace(codepoint, std::move(entry)).first->second.glyph;
+}
+
+void FontAtlas::mark_dirty(int x0, int y0, int x1, int y1) {
+    for (AtlasTexture* texture : textures) {
+        AtlasTexture& t = *texture;
+        if (t.dirty_x0 >= t.dirty_x1) {
+            t.dirty_x0 = x0; t.dirty_y0 = y0; t.dirty_x1 = x1; t.dirty_y1 = y1;
+            continue;
+        }
+        t.dirty_x0 = std::min(t.dirty_x0, x0);
+        t.dirty_y0 = std::min(t.dirty_y0, y0);
+        t.dirty_x1 = std::max(t.dirty_x1, x1);
+        t.dirty_y1 = std::max(t.dirty_y1, y1);
+    }
+}
+
+void FontAtlas::upload(AtlasTexture& texture) {
+    glGenTextures(1, &texture.tex);
+    glBindTexture(GL_TEXTURE_2D, texture.tex);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, SIZE, SIZE, 0, GL_RED, GL_UNSIGNED_BYTE, NULL);
+    // Bilinear filtering of the distance is what makes scaled edges smooth
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    textures.push_back(&texture);
+    texture.dirty_x0 = texture.dirty_y0 = 0;
+    texture.dirty_x1 = texture.dirty_y1 = SIZE;
+    flush(texture);
+}
+
+void FontAtlas::flush(AtlasTexture& t) {
+    if (!t.tex || t.dirty_x0 >= t.dirty_x1) return;
+
+    // Unpack state belongs to the application (it may even have a pixel buffer
+    // bound), so it's saved around the upload; this only runs when glyphs change
+    GLint last_unpack_buffer, last_alignment, last_row_length, last_skip_pixels, last_skip_rows;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &last_unpack_buffer);
+    glGetIntegerv(GL_UNPACK_ALIGNMENT, &last_alignment);
+    glGetIntegerv(GL_UNPACK_ROW_LENGTH, &last_row_length);
+    glGetIntegerv(GL_UNPACK_SKIP_PIXELS, &last_skip_pixels);
+    glGetIntegerv(GL_UNPACK_SKIP_ROWS, &last_skip_rows);
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, SIZE);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, t.dirty_x0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, t.dirty_y0);
+    glBindTexture(GL_TEXTURE_2D, t.tex);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, t.dirty_x0, t.dirty_y0, t.dirty_x1 - t.dirty_x0, t.dirty_y1 - t.dirty_y0,
+                    GL_RED, GL_UNSIGNED_BYTE, bitmap.data());
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, last_unpack_buffer);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, last_alignment);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, last_row_length);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, last_skip_pixels);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, last_skip_rows);
+    t.dirty_x0 = t.dirty_y0 = t.dirty_x1 = t.dirty_y1 = 0;
+}
+
+void FontAtlas::release(AtlasTexture& texture) {
+    textures.erase(std::remove(textures.begin(), textures.end(), &texture), textures.end());
+    texture = AtlasTexture{};
+}
@@ -0,0 +1,114 @@
+#ifndef FONT_ATLAS_HPP
+#define FONT_ATLAS_HPP
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "stb_truetype.h"
+
+// A glyph's place in the atlas and its metrics, in atlas pixels
+// (the font rendered at FontAtlas::PIXEL_HEIGHT)
+struct AtlasGlyph {
+    uint16_t x = 0, y = 0, w = 0, h = 0; // Rectangle in the atlas, texels; empty for blanks
+    float xoff = 0.0f, yoff = 0.0f;      // From the pen position on the baseline to the top-left
+    float advance = 0.0f;
+};
+
+// The atlas texture in one GL share group, and the texels it hasn't received yet
+struct AtlasTexture {
+    GLuint tex = 0;
+    // Empty when x0 >= x1
+    int dirty_x0 = 0, dirty_y0 = 0, dirty_x1 = 0, dirty_y1 = 0;
+};
+
+// Signed distance field atlas: each texel stores the distance to the glyph
+// outline (ON_EDGE on the edge, increasing inside), so the text shader can
+// render crisp edges at any scale from this one small texture; scale and
+// resolution changes never re-bake it.
+//
+// Glyphs are rasterized the first time a codepoint is asked for and packed
+// with a skyline packer. When the atlas is full, the least recently used
+// glyphs are dropped and the rest repacked from their CPU copies, which bumps
+// generation() since rectangles move. Only the changed texels are uploaded, so
+// a stable set of text costs no rasterization and no uploads. Textures don't
+// cross share groups, so there is one AtlasTexture per group drawn in, each
+// catching up on its own.
+//
+// The up-front ASCII set is cached on disk, keyed by a hash of the font file
+// and the atlas parameters, so later launches map the file instead of
+// rasterizing.
+class FontAtlas {
+public:
+    static constexpr int SIZE = 512;                 // Texture width and height
+    static constexpr float PIXEL_HEIGHT = 32.0f;     // Size the distance fields are computed at
+    static constexpr int PADDING = 4;                // Texels of field around each glyph
+    static constexpr unsigned char ON_EDGE = 128;
+    static constexpr uint32_t FIRST_CHAR = 32, CHAR_COUNT = 95; // Printable ASCII, rasterized up front
+
+    // Takes the font file and loads the ASCII set from the cache in
+    // `cache_dir`, or rasterizes it and writes the cache (skipped if empty); no GL calls
+    bool build(std::vector<unsigned char> font_file, const std::string& cache_dir);
+    // Same, for font data that outlives the atlas (the embedded font), without a copy
+    bool build(const unsigned char* font_file, size_t size, const std::string& cache_dir);
+    bool loaded_from_cache() const { return cache_hit; }
+    // Creates `texture` in the current share group from the built bitmap; it
+    // must stay at the same address until release()
+    void upload(AtlasTexture& texture);
+    // Uploads texels changed since `texture` was last flushed, if any
+    void flush(AtlasTexture& texture);
+    // Forgets a texture that went away with its share group; no GL calls
+    void release(AtlasTexture& texture);
+
+    // Distances from the baseline up to the font's ascender and down to its
+    // descender, in atlas pixels
+    float ascent() const { return font_ascent; }
+    float descent() const { return font_descent; }
+    // Widest advance among '0'-'9': the slot every digit is laid out in
+    float digit_advance() const { return digit_width; }
+    // Changes whenever existing glyphs move, which invalidates laid out text
+    unsigned generation() const { return atlas_generation; }
+
+    // Marks the start of a layout pass; glyphs looked up since are never evicted by it
+    void begin_pass() { ++clock; }
+    // Metrics for a codepoint, rasterizing it on first use. Codepoints the
+    // font lacks get its missing-glyph box. Returns nullptr only for glyphs
+    // too big for the atlas.
+    const AtlasGlyph* glyph(uint32_t codepoint);
+
+private:
+    struct Entry {
+        AtlasGlyph glyph;
+        std::vector<unsigned char> sdf; // CPU copy, w * h texels, for repacking
+        uint64_t last_used = 0;
+    };
+    struct SkylineNode { int x, y, width; };
+
+    bool rasterize(uint32_t codepoint, Entry& entry);
+    bool pack(int w, int h, int& out_x, int& out_y);
+    void blit(const Entry& entry);
+    bool place(Entry& entry);
+    void evict_and_repack();
+    void mark_dirty(int x0, int y0, int x1, int y1);
+    uint64_t cache_key() const;
+    bool load_cache(const std::string& path, uint64_t key);
+    void save_cache(const std::string& path, uint64_t key) const;
+
+    std::vector<unsigned char> font_storage; // Owned font file, if it was loaded from disk
+    const unsigned char* font_data = nullptr;
+    size_t font_size = 0;
+    stbtt_fontinfo font;
+    float scale = 0.0f;
+    float font_ascent = 0.0f, font_descent = 0.0f, digit_width = 0.0f;
+    std::unordered_map<uint32_t, Entry> glyphs;
+    std::vector<SkylineNode> skyline;
+    std::vector<unsigned char> bitmap;
+    uint64_t clock = 0;
+    unsigned atlas_generation = 0;
+    bool cache_hit = false;
+    std::vector<AtlasTexture*> textures; // Uploaded copies, told about every change
+};
+
+#endif // FONT_ATLAS_HPP
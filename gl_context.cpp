@@ -0,0 +1,86 @@
+#include "gl_context.hpp"
+#include <iostream>
+
+// Context creation and binding report failure through X errors, which would
+// otherwise terminate the application; swallow them while we try
+static bool x_error_seen = false;
+static int ignore_x_error(Display*, XErrorEvent*) {
+    x_error_seen = true;
+    return 0;
+}
+
+bool OverlayContext::create(Display* display, GLXContext app_context) {
+    dpy = display;
+    int fbconfig_id = 0, screen = 0;
+    if (glXQueryContext(dpy, app_context, GLX_FBCONFIG_ID, &fbconfig_id) != Success ||
+        glXQueryContext(dpy, app_context, GLX_SCREEN, &screen) != Success) {
+        return false;
+    }
+    const int config_attribs[] = { GLX_FBCONFIG_ID, fbconfig_id, None };
+    int count = 0;
+    GLXFBConfig* configs = glXChooseFBConfig(dpy, screen, config_attribs, &count);
+    if (!configs || count == 0) return false;
+
+    auto create_context_attribs = (PFNGLXCREATECONTEXTATTRIBSARBPROC)
+        glXGetProcAddressARB((const GLubyte*)"glXCreateContextAttribsARB");
+    if (create_context_attribs) {
+        const int context_attribs[] = {
+            GLX_CONTEXT_MAJOR_VERSION_ARB, 3,
+            GLX_CONTEXT_MINOR_VERSION_ARB, 3,
+            GLX_CONTEXT_PROFILE_MASK_ARB, GLX_CONTEXT_CORE_PROFILE_BIT_ARB,
+            None
+        };
+        XSync(dpy, False);
+        x_error_seen = false;
+        int (*last_handler)(Display*, XErrorEvent*) = XSetErrorHandler(ignore_x_error);
+        context = create_context_attribs(dpy, configs[0], app_context, True, context_attribs);
+        XSync(dpy, False);
+        XSetErrorHandler(last_handler);
+        if (x_error_seen) context = nullptr;
+    }
+    XFree(configs);
+    if (!context) {
+        std::cerr << "Overlay Error: Could not create a dedicated GL context" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void OverlayContext::destroy() {
+    if (context) glXDestroyContext(dpy, context);
+    context = nullptr;
+    checked_drawable = 0;
+}
+
+bool OverlayContext::begin(GLXDrawable drawable) {
+    // These are client-side lookups, no round trip
+    saved_context = glXGetCurrentContext();
+    saved_draw = glXGetCurrentDrawable();
+    saved_read = glXGetCurrentReadDrawable();
+    if (drawable == checked_drawable) {
+        return drawable_ok && glXMakeContextCurrent(dpy, drawable, drawable, context);
+    }
+
+    // First frame on this drawable: it may not match our FBConfig, which is a
+    // BadMatch. Try once under the error trap and remember the answer, so the
+    // round trips are only paid when the application switches drawables.
+    checked_drawable = drawable;
+    XSync(dpy, False);
+    x_error_seen = false;
+    int (*last_handler)(Display*, XErrorEvent*) = XSetErrorHandler(ignore_x_error);
+    drawable_ok = glXMakeContextCurrent(dpy, drawable, drawable, context);
+    XSync(dpy, False);
+    XSetErrorHandler(last_handler);
+    if (x_error_seen) drawable_ok = false;
+    if (!drawable_ok) {
+        end();
+        std::cerr << "Overlay Error: Drawable 0x" << std::hex << drawable << std::dec
+                  << " doesn't accept the dedicated GL context, drawing in the application's" << std::endl;
+    }
+    return drawable_ok;
+}
+
+void OverlayContext::end() {
+    // Switching back implicitly flushes our commands ahead of the application's swap
+    glXMakeContextCurrent(dpy, saved_draw, saved_read, saved_context);
+}
@@ -0,0 +1,36 @@
+#ifndef GL_CONTEXT_HPP
+#define GL_CONTEXT_HPP
+
+#include <GL/glew.h>
+#include <GL/glx.h>
+
+// A GLX context of our own, in the application's share group, that renders to
+// the application's drawable. Drawing through it leaves every piece of the
+// application's GL state untouched, so nothing has to be queried or restored;
+// the price is two glXMakeContextCurrent calls per frame.
+class OverlayContext {
+public:
+    // Creates a 3.3 core context with the same FBConfig as `app_context`,
+    // sharing its objects. Returns false (without disturbing the app) on failure.
+    bool create(Display* dpy, GLXContext app_context);
+    void destroy();
+    bool valid() const { return context != nullptr; }
+
+    // Makes our context current on `drawable`, remembering the application's bindings.
+    // Returns false, with the application's context still current, if the drawable
+    // can't take our context (an incompatible FBConfig, say).
+    bool begin(GLXDrawable drawable);
+    // Rebinds the application's context and drawables
+    void end();
+
+private:
+    Display* dpy = nullptr;
+    GLXContext context = nullptr;
+    GLXContext saved_context = nullptr;
+    GLXDrawable saved_draw = 0, saved_read = 0;
+    // Last drawable begin() tried, and whether our context could be made current on it
+    GLXDrawable checked_drawable = 0;
+    bool drawable_ok = false;
+};
+
+#endif // GL_CONTEXT_HPP
@@ -0,0 +1,645 @@
+// This file defines the GL entry points it interposes, so it must not see
+// GLEW's macros; it only uses the plain GL and GLX headers.
+#include "gl_shadow.hpp"
+#include "context_map.hpp"
+#include <GL/glext.h>
+#include <GL/glx.h>
+#include <dlfcn.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+// --- Real entry points ---
+static __GLXextFuncPtr real_proc(const char* name) {
+    static auto real_get_proc = (PFNGLXGETPROCADDRESSPROC)dlsym(RTLD_NEXT, "glXGetProcAddressARB");
+    if (!real_get_proc) return nullptr;
+    return real_get_proc((const GLubyte*)name);
+}
+
+// Resolved on first use; a race only resolves the same pointer twice
+#define REAL(type, name) \
+    static auto real_##name = (type)real_proc(#name)
+
+// --- Per-context shadows ---
+struct ContextShadow {
+    GLXContext context;
+    GLShadowState state;
+    int current_threads = 0; // Threads that have the context current
+    bool destroyed = false;  // Freed when the last of them switches away
+};
+
+// Make-current and destroy are rare, a locked list is plenty
+static std::mutex shadows_mutex;
+static std::vector<ContextShadow*> shadows;
+
+static thread_local ContextShadow* current_shadow = nullptr;
+static thread_local GLShadowState* current = nullptr;
+static thread_local bool suspended = false;
+
+// Switches the calling thread's shadow to `context`'s
+static void make_current(GLXContext context) {
+    std::lock_guard<std::mutex> lock(shadows_mutex);
+    ContextShadow* next = nullptr;
+    if (context) {
+        // A destroyed context that is still current somewhere keeps its handle
+        // until released, so its retired shadow is still the one to pick up
+        for (ContextShadow* s : shadows) {
+            if (s->context == context) next = s;
+        }
+        if (!next) {
+            next = new ContextShadow{context, GLShadowState{}};
+            shadows.push_back(next);
+        }
+    }
+    if (next == current_shadow) return;
+    if (next) next->current_threads++;
+    if (ContextShadow* last = current_shadow) {
+        if (--last->current_threads == 0 && last->destroyed) {
+            shadows.erase(std::find(shadows.begin(), shadows.end(), last));
+            delete last;
+        }
+    }
+    current_shadow = next;
+    current = next ? &next->state : nullptr;
+}
+
+static void forget_shadow(GLXContext context) {
+    std::lock_guard<std::mutex> lock(shadows_mutex);
+    for (size_t i = 0; i < shadows.size(); ++i) {
+        if (shadows[i]->context == context && !shadows[i]->destroyed) {
+            // GLX defers destroying a context that is still current somewhere,
+            // and those threads keep drawing with it; their shadow has to outlive
+            // this call, and stay findable, until the last of them switches away
+            if (shadows[i]->current_threads > 0) {
+                shadows[i]->destroyed = true;
+                return;
+            }
+            delete shadows[i];
+            shadows.erase(shadows.begin() + i);
+            return;
+        }
+    }
+}
+
+// --- Share groups ---
+// Every context the application creates, by the group it joined: its share
+// list's, or a new one. The overlay's own contexts are created while suspended
+// and never counted, so they can't keep a group "alive" on their own.
+static ContextMap<unsigned, 256> share_groups;
+static std::atomic<unsigned> next_share_group{1};
+static std::atomic<void (*)(GLXContext, unsigned)> destroy_callback{nullptr};
+
+static void track_context(GLXContext context, GLXContext share_list) {
+    if (!context || suspended) return;
+    unsigned group = share_list ? gl_share_group(share_list) : 0;
+    if (!group) group = next_share_group.fetch_add(1, std::memory_order_relaxed);
+    // Published to other threads along with the context handle itself
+    if (unsigned* entry = share_groups.insert(context)) *entry = group;
+}
+
+// Tracked state is only updated for the application's calls
+static inline GLShadowState* tracking() {
+    return suspended ? nullptr : current;
+}
+
+// --- Interposed state setters ---
+extern "C" {
+
+void glUseProgram(GLuint program) {
+    REAL(PFNGLUSEPROGRAMPROC, glUseProgram);
+    real_glUseProgram(program);
+    if (GLShadowState* s = tracking()) s->program = program;
+}
+
+void glBindVertexArray(GLuint array) {
+    REAL(PFNGLBINDVERTEXARRAYPROC, glBindVertexArray);
+    real_glBindVertexArray(array);
+    if (GLShadowState* s = tracking()) s->vertex_array = array;
+}
+
+void glBindBuffer(GLenum target, GLuint buffer) {
+    REAL(PFNGLBINDBUFFERPROC, glBindBuffer);
+    real_glBindBuffer(target, buffer);
+    if (target != GL_ARRAY_BUFFER) return;
+    if (GLShadowState* s = tracking()) s->array_buffer = buffer;
+}
+
+void glBindFramebuffer(GLenum target, GLuint framebuffer) {
+    REAL(PFNGLBINDFRAMEBUFFERPROC, glBindFramebuffer);
+    real_glBindFramebuffer(target, framebuffer);
+    GLShadowState* s = tracking();
+    if (!s) return;
+    if (target == GL_FRAMEBUFFER || target == GL_DRAW_FRAMEBUFFER) s->draw_framebuffer = framebuffer;
+    if (target == GL_FRAMEBUFFER || target == GL_READ_FRAMEBUFFER) s->read_framebuffer = framebuffer;
+}
+
+void glActiveTexture(GLenum texture) {
+    REAL(PFNGLACTIVETEXTUREPROC, glActiveTexture);
+    real_glActiveTexture(texture);
+    if (GLShadowState* s = tracking()) {
+        s->active_texture = texture;
+        s->known |= SHADOW_ACTIVE_TEXTURE;
+    }
+}
+
+void glBindTexture(GLenum target, GLuint texture) {
+    REAL(PFNGLBINDTEXTUREEXTPROC, glBindTexture);
+    real_glBindTexture(target, texture);
+    GLShadowState* s = tracking();
+    if (!s || target != GL_TEXTURE_2D) return;
+    if (!(s->known & SHADOW_ACTIVE_TEXTURE)) {
+        s->known &= ~SHADOW_TEXTURE_2D;
+    } else if (s->active_texture == GL_TEXTURE0) {
+        s->texture_2d = texture;
+    }
+}
+
+static void set_capability(GLShadowState* s, GLenum cap, GLboolean value) {
+    switch (cap) {
+        case GL_BLEND:        s->blend = value; s->known |= SHADOW_BLEND; break;
+        case GL_CULL_FACE:    s->cull_face = value; s->known |= SHADOW_CULL_FACE; break;
+        case GL_DEPTH_TEST:   s->depth_test = value; s->known |= SHADOW_DEPTH_TEST; break;
+        case GL_SCISSOR_TEST: s->scissor_test = value; s->known |= SHADOW_SCISSOR_TEST; break;
+        default: break;
+    }
+}
+
+void glEnable(GLenum cap) {
+    REAL(void (*)(GLenum), glEnable);
+    real_glEnable(cap);
+    if (GLShadowState* s = tracking()) set_capability(s, cap, GL_TRUE);
+}
+
+void glDisable(GLenum cap) {
+    REAL(void (*)(GLenum), glDisable);
+    real_glDisable(cap);
+    if (GLShadowState* s = tracking()) set_capability(s, cap, GL_FALSE);
+}
+
+void glBlendFunc(GLenum sfactor, GLenum dfactor) {
+    REAL(void (*)(GLenum, GLenum), glBlendFunc);
+    real_glBlendFunc(sfactor, dfactor);
+    if (GLShadowState* s = tracking()) {
+        s->blend_src_rgb = s->blend_src_alpha = sfactor;
+        s->blend_dst_rgb = s->blend_dst_alpha = dfactor;
+        s->known |= SHADOW_BLEND_FUNC;
+    }
+}
+
+void glBlendFuncSeparate(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+    REAL(PFNGLBLENDFUNCSEPARATEPROC, glBlendFuncSeparate);
+    real_glBlendFuncSeparate(src_rgb, dst_rgb, src_alpha, dst_alpha);
+    if (GLShadowState* s = tracking()) {
+        s->blend_src_rgb = src_rgb;
+        s->blend_dst_rgb = dst_rgb;
+        s->blend_src_alpha = src_alpha;
+        s->blend_dst_alpha = dst_alpha;
+        s->known |= SHADOW_BLEND_FUNC;
+    }
+}
+
+void glViewport(GLint x, GLint y, GLsizei width, GLsizei height) {
+    REAL(void (*)(GLint, GLint, GLsizei, GLsizei), glViewport);
+    real_glViewport(x, y, width, height);
+    if (GLShadowState* s = tracking()) {
+        s->viewport[0] = x;
+        s->viewport[1] = y;
+        s->viewport[2] = width;
+        s->viewport[3] = height;
+        s->known |= SHADOW_VIEWPORT;
+    }
+}
+
+// Deleting a bound object reverts the binding to zero
+void glDeleteTextures(GLsizei n, const GLuint* textures) {
+    REAL(void (*)(GLsizei, const GLuint*), glDeleteTextures);
+    real_glDeleteTextures(n, textures);
+    GLShadowState* s = tracking();
+    if (!s) return;
+    for (GLsizei i = 0; i < n; ++i) {
+        if (textures[i] != 0 && textures[i] == s->texture_2d) s->texture_2d = 0;
+    }
+}
+
+void glDeleteBuffers(GLsizei n, const GLuint* buffers) {
+    REAL(PFNGLDELETEBUFFERSPROC, glDeleteBuffers);
+    real_glDeleteBuffers(n, buffers);
+    GLShadowState* s = tracking();
+    if (!s) return;
+    for (GLsizei i = 0; i < n; ++i) {
+        if (buffers[i] != 0 && buffers[i] == s->array_buffer) s->array_buffer = 0;
+    }
+}
+
+void glDeleteVertexArrays(GLsizei n, const GLuint* arrays) {
+    REAL(PFNGLDELETEVERTEXARRAYSPROC, glDeleteVertexArrays);
+    real_glDeleteVertexArrays(n, arrays);
+    GLShadowState* s = tracking();
+    if (!s) return;
+    for (GLsizei i = 0; i < n; ++i) {
+        if (arrays[i] != 0 && arrays[i] == s->vertex_array) s->vertex_array = 0;
+    }
+}
+
+void glDeleteFramebuffers(GLsizei n, const GLuint* framebuffers) {
+    REAL(PFNGLDELETEFRAMEBUFFERSPROC, glDeleteFramebuffers);
+    real_glDeleteFramebuffers(n, framebuffers);
+    GLShadowState* s = tracking();
+    if (!s) return;
+    for (GLsizei i = 0; i < n; ++i) {
+        if (framebuffers[i] == 0) continue;
+        if (framebuffers[i] == s->draw_framebuffer) s->draw_framebuffer = 0;
+        if (framebuffers[i] == s->read_framebuffer) s->read_framebuffer = 0;
+    }
+}
+
+// --- Paths we don't follow: mark what they may change as unknown ---
+void glPopAttrib() {
+    REAL(void (*)(), glPopAttrib);
+    real_glPopAttrib();
+    if (GLShadowState* s = tracking()) {
+        s->known &= ~(SHADOW_ACTIVE_TEXTURE | SHADOW_TEXTURE_2D | SHADOW_BLEND | SHADOW_CULL_FACE |
+                      SHADOW_DEPTH_TEST | SHADOW_SCISSOR_TEST | SHADOW_BLEND_FUNC | SHADOW_VIEWPORT);
+    }
+}
+
+// Display lists can hold any of the setters above
+void glCallList(GLuint list) {
+    REAL(void (*)(GLuint), glCallList);
+    real_glCallList(list);
+    if (GLShadowState* s = tracking()) s->known &= SHADOW_PROGRAM | SHADOW_VERTEX_ARRAY |
+                                                   SHADOW_ARRAY_BUFFER | SHADOW_FRAMEBUFFER;
+}
+
+void glCallLists(GLsizei n, GLenum type, const GLvoid* lists) {
+    REAL(void (*)(GLsizei, GLenum, const GLvoid*), glCallLists);
+    real_glCallLists(n, type, lists);
+    if (GLShadowState* s = tracking()) s->known &= SHADOW_PROGRAM | SHADOW_VERTEX_ARRAY |
+                                                   SHADOW_ARRAY_BUFFER | SHADOW_FRAMEBUFFER;
+}
+
+void glEnablei(GLenum cap, GLuint index) {
+    REAL(PFNGLENABLEIPROC, glEnablei);
+    real_glEnablei(cap, index);
+    if (GLShadowState* s = tracking()) {
+        if (cap == GL_BLEND && index == 0) s->known &= ~SHADOW_BLEND;
+    }
+}
+
+void glDisablei(GLenum cap, GLuint index) {
+    REAL(PFNGLDISABLEIPROC, glDisablei);
+    real_glDisablei(cap, index);
+    if (GLShadowState* s = tracking()) {
+        if (cap == GL_BLEND && index == 0) s->known &= ~SHADOW_BLEND;
+    }
+}
+
+void glBlendFunci(GLuint buf, GLenum src, GLenum dst) {
+    REAL(PFNGLBLENDFUNCIPROC, glBlendFunci);
+    real_glBlendFunci(buf, src, dst);
+    if (GLShadowState* s = tracking()) {
+        if (buf == 0) s->known &= ~SHADOW_BLEND_FUNC;
+    }
+}
+
+void glBlendFuncSeparatei(GLuint buf, GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+    REAL(PFNGLBLENDFUNCSEPARATEIPROC, glBlendFuncSeparatei);
+    real_glBlendFuncSeparatei(buf, src_rgb, dst_rgb, src_alpha, dst_alpha);
+    if (GLShadowState* s = tracking()) {
+        if (buf == 0) s->known &= ~SHADOW_BLEND_FUNC;
+    }
+}
+
+void glBindTextureUnit(GLuint unit, GLuint texture) {
+    REAL(PFNGLBINDTEXTUREUNITPROC, glBindTextureUnit);
+    real_glBindTextureUnit(unit, texture);
+    // The target comes from the texture object, which we don't track
+    if (GLShadowState* s = tracking()) {
+        if (unit == 0) s->known &= ~SHADOW_TEXTURE_2D;
+    }
+}
+
+void glBindTextures(GLuint first, GLsizei count, const GLuint* textures) {
+    REAL(PFNGLBINDTEXTURESPROC, glBindTextures);
+    real_glBindTextures(first, count, textures);
+    if (GLShadowState* s = tracking()) {
+        if (first == 0 && count > 0) s->known &= ~SHADOW_TEXTURE_2D;
+    }
+}
+
+void glViewportIndexedf(GLuint index, GLfloat x, GLfloat y, GLfloat w, GLfloat h) {
+    REAL(PFNGLVIEWPORTINDEXEDFPROC, glViewportIndexedf);
+    real_glViewportIndexedf(index, x, y, w, h);
+    if (GLShadowState* s = tracking()) {
+        if (index == 0) s->known &= ~SHADOW_VIEWPORT;
+    }
+}
+
+void glViewportArrayv(GLuint first, GLsizei count, const GLfloat* v) {
+    REAL(PFNGLVIEWPORTARRAYVPROC, glViewportArrayv);
+    real_glViewportArrayv(first, count, v);
+    if (GLShadowState* s = tracking()) {
+        if (first == 0 && count > 0) s->known &= ~SHADOW_VIEWPORT;
+    }
+}
+
+// --- Extension aliases ---
+// Older code resolves the ARB/EXT/APPLE names of these entry points. Their
+// objects don't always share the core names' namespace, so instead of being
+// tracked, the fields they touch are queried again the next time they're needed.
+static inline void mark_unknown(uint32_t fields) {
+    if (GLShadowState* s = tracking()) s->known &= ~fields;
+}
+
+void glUseProgramObjectARB(GLhandleARB program) {
+    REAL(PFNGLUSEPROGRAMOBJECTARBPROC, glUseProgramObjectARB);
+    real_glUseProgramObjectARB(program);
+    mark_unknown(SHADOW_PROGRAM);
+}
+
+void glBindVertexArrayAPPLE(GLuint array) {
+    REAL(PFNGLBINDVERTEXARRAYAPPLEPROC, glBindVertexArrayAPPLE);
+    real_glBindVertexArrayAPPLE(array);
+    mark_unknown(SHADOW_VERTEX_ARRAY);
+}
+
+void glDeleteVertexArraysAPPLE(GLsizei n, const GLuint* arrays) {
+    REAL(PFNGLDELETEVERTEXARRAYSAPPLEPROC, glDeleteVertexArraysAPPLE);
+    real_glDeleteVertexArraysAPPLE(n, arrays);
+    mark_unknown(SHADOW_VERTEX_ARRAY);
+}
+
+void glBindBufferARB(GLenum target, GLuint buffer) {
+    REAL(PFNGLBINDBUFFERARBPROC, glBindBufferARB);
+    real_glBindBufferARB(target, buffer);
+    if (target == GL_ARRAY_BUFFER) mark_unknown(SHADOW_ARRAY_BUFFER);
+}
+
+void glDeleteBuffersARB(GLsizei n, const GLuint* buffers) {
+    REAL(PFNGLDELETEBUFFERSARBPROC, glDeleteBuffersARB);
+    real_glDeleteBuffersARB(n, buffers);
+    mark_unknown(SHADOW_ARRAY_BUFFER);
+}
+
+void glBindFramebufferEXT(GLenum target, GLuint framebuffer) {
+    REAL(PFNGLBINDFRAMEBUFFEREXTPROC, glBindFramebufferEXT);
+    real_glBindFramebufferEXT(target, framebuffer);
+    mark_unknown(SHADOW_FRAMEBUFFER);
+}
+
+void glDeleteFramebuffersEXT(GLsizei n, const GLuint* framebuffers) {
+    REAL(PFNGLDELETEFRAMEBUFFERSEXTPROC, glDeleteFramebuffersEXT);
+    real_glDeleteFramebuffersEXT(n, framebuffers);
+    mark_unknown(SHADOW_FRAMEBUFFER);
+}
+
+void glActiveTextureARB(GLenum texture) {
+    REAL(PFNGLACTIVETEXTUREARBPROC, glActiveTextureARB);
+    real_glActiveTextureARB(texture);
+    mark_unknown(SHADOW_ACTIVE_TEXTURE);
+}
+
+void glBindTextureEXT(GLenum target, GLuint texture) {
+    REAL(PFNGLBINDTEXTUREEXTPROC, glBindTextureEXT);
+    real_glBindTextureEXT(target, texture);
+    if (target == GL_TEXTURE_2D) mark_unknown(SHADOW_TEXTURE_2D);
+}
+
+void glDeleteTexturesEXT(GLsizei n, const GLuint* textures) {
+    REAL(PFNGLDELETETEXTURESEXTPROC, glDeleteTexturesEXT);
+    real_glDeleteTexturesEXT(n, textures);
+    mark_unknown(SHADOW_TEXTURE_2D);
+}
+
+void glBlendFuncSeparateEXT(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+    REAL(PFNGLBLENDFUNCSEPARATEEXTPROC, glBlendFuncSeparateEXT);
+    real_glBlendFuncSeparateEXT(src_rgb, dst_rgb, src_alpha, dst_alpha);
+    mark_unknown(SHADOW_BLEND_FUNC);
+}
+
+void glBlendFuncSeparateINGR(GLenum src_rgb, GLenum dst_rgb, GLenum src_alpha, GLenum dst_alpha) {
+    REAL(PFNGLBLENDFUNCSEPARATEINGRPROC, glBlendFuncSeparateINGR);
+    real_glBlendFuncSeparateINGR(src_rgb, dst_rgb, src_alpha, dst_alpha);
+    mark_unknown(SHADOW_BLEND_FUNC);
+}
+
+// --- Context tracking ---
+Bool glXMakeCurrent(Display* dpy, GLXDrawable drawable, GLXContext context) {
+    REAL(Bool (*)(Display*, GLXDrawable, GLXContext), glXMakeCurrent);
+    Bool ok = real_glXMakeCurrent(dpy, drawable, context);
+    if (ok) make_current(context);
+    return ok;
+}
+
+Bool glXMakeContextCurrent(Display* dpy, GLXDrawable draw, GLXDrawable read, GLXContext context) {
+    REAL(Bool (*)(Display*, GLXDrawable, GLXDrawable, GLXContext), glXMakeContextCurrent);
+    Bool ok = real_glXMakeContextCurrent(dpy, draw, read, context);
+    if (ok) make_current(context);
+    return ok;
+}
+
+void glXDestroyContext(Display* dpy, GLXContext context) {
+    REAL(void (*)(Display*, GLXContext), glXDestroyContext);
+    real_glXDestroyContext(dpy, context);
+    // A new context can reuse the handle; it must start from the defaults again
+    forget_shadow(context);
+    unsigned group = gl_share_group(context);
+    share_groups.erase(context);
+    if (auto callback = destroy_callback.load(std::memory_order_acquire)) callback(context, group);
+}
+
+GLXContext glXCreateContext(Display* dpy, XVisualInfo* visual, GLXContext share_list, Bool direct) {
+    REAL(GLXContext (*)(Display*, XVisualInfo*, GLXContext, Bool), glXCreateContext);
+    GLXContext context = real_glXCreateContext(dpy, visual, share_list, direct);
+    track_context(context, share_list);
+    return context;
+}
+
+GLXContext glXCreateNewContext(Display* dpy, GLXFBConfig config, int render_type, GLXContext share_list, Bool direct) {
+    REAL(GLXContext (*)(Display*, GLXFBConfig, int, GLXContext, Bool), glXCreateNewContext);
+    GLXContext context = real_glXCreateNewContext(dpy, config, render_type, share_list, direct);
+    track_context(context, share_list);
+    return context;
+}
+
+GLXContext glXCreateContextAttribsARB(Display* dpy, GLXFBConfig config, GLXContext share_context, Bool direct, const int* attribs) {
+    REAL(PFNGLXCREATECONTEXTATTRIBSARBPROC, glXCreateContextAttribsARB);
+    if (!real_glXCreateContextAttribsARB) return nullptr;
+    GLXContext context = real_glXCreateContextAttribsARB(dpy, config, share_context, direct, attribs);
+    track_context(context, share_context);
+    return context;
+}
+
+} // extern "C"
+
+// --- glXGetProcAddress ---
+// Applications that load GL through glXGetProcAddress (SDL, GLEW...) would
+// bypass the symbols above, so hand them our versions instead. Entry points
+// resolved with dlsym on libGL itself (libepoxy does this for the GL 1.x core
+// functions) still bypass us, which is why the shadow path is opt-in only.
+struct HookedProc {
+    const char* name;
+    __GLXextFuncPtr proc;
+};
+
+#define HOOK(name) { #name, (__GLXextFuncPtr)&name }
+static const HookedProc hooked_procs[] = {
+    HOOK(glUseProgram), HOOK(glBindVertexArray), HOOK(glBindBuffer), HOOK(glBindFramebuffer),
+    HOOK(glActiveTexture), HOOK(glBindTexture), HOOK(glEnable), HOOK(glDisable),
+    HOOK(glBlendFunc), HOOK(glBlendFuncSeparate), HOOK(glViewport),
+    HOOK(glDeleteTextures), HOOK(glDeleteBuffers), HOOK(glDeleteVertexArrays), HOOK(glDeleteFramebuffers),
+    HOOK(glPopAttrib), HOOK(glCallList), HOOK(glCallLists), HOOK(glEnablei), HOOK(glDisablei),
+    HOOK(glBlendFunci), HOOK(glBlendFuncSeparatei), HOOK(glBindTextureUnit), HOOK(glBindTextures),
+    HOOK(glViewportIndexedf), HOOK(glViewportArrayv),
+    HOOK(glUseProgramObjectARB), HOOK(glBindVertexArrayAPPLE), HOOK(glDeleteVertexArraysAPPLE),
+    HOOK(glBindBufferARB), HOOK(glDeleteBuffersARB), HOOK(glBindFramebufferEXT), HOOK(glDeleteFramebuffersEXT),
+    HOOK(glActiveTextureARB), HOOK(glBindTextureEXT), HOOK(glDeleteTexturesEXT),
+    HOOK(glBlendFuncSeparateEXT), HOOK(glBlendFuncSeparateINGR),
+    HOOK(glXMakeCurrent), HOOK(glXMakeContextCurrent), HOOK(glXDestroyContext),
+    HOOK(glXCreateContext), HOOK(glXCreateNewContext), HOOK(glXCreateContextAttribsARB),
+    HOOK(glXSwapBuffers),
+};
+#undef HOOK
+
+extern "C" __GLXextFuncPtr glXGetProcAddressARB(const GLubyte* name) {
+    const char* n = (const char*)name;
+    // Every hooked name starts with "gl"; skip the table for anything else quickly
+    if (n && n[0] == 'g' && n[1] == 'l') {
+        for (const HookedProc& h : hooked_procs) {
+            if (strcmp(n, h.name) == 0) return h.proc;
+        }
+    }
+    return real_proc(n);
+}
+
+extern "C" __GLXextFuncPtr glXGetProcAddress(const GLubyte* name) {
+    return glXGetProcAddressARB(name);
+}
+
+// --- Overlay side ---
+unsigned gl_share_group(GLXContext context) {
+    if (!context) return 0;
+    const unsigned* group = share_groups.find(context);
+    return group ? *group : 0;
+}
+
+bool gl_share_group_alive(unsigned group) {
+    bool alive = false;
+    share_groups.for_each([&](GLXContext, unsigned g) { alive |= g == group; });
+    return alive;
+}
+
+void gl_shadow_on_destroy(void (*callback)(GLXContext context, unsigned share_group)) {
+    destroy_callback.store(callback, std::memory_order_release);
+}
+
+void gl_shadow_suspend() { suspended = true; }
+void gl_shadow_resume() { suspended = false; }
+
+const GLShadowState* gl_shadow_sync() {
+    GLShadowState* s = current;
+    if (!s) return nullptr;
+    if (s->known == SHADOW_ALL) return s;
+
+    // Fill in what we lost track of, once; later frames need no queries
+    GLint v[4];
+    if (!(s->known & SHADOW_PROGRAM)) { glGetIntegerv(GL_CURRENT_PROGRAM, v); s->program = v[0]; }
+    if (!(s->known & SHADOW_VERTEX_ARRAY)) { glGetIntegerv(GL_VERTEX_ARRAY_BINDING, v); s->vertex_array = v[0]; }
+    if (!(s->known & SHADOW_ARRAY_BUFFER)) { glGetIntegerv(GL_ARRAY_BUFFER_BINDING, v); s->array_buffer = v[0]; }
+    if (!(s->known & SHADOW_FRAMEBUFFER)) {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, v); s->draw_framebuffer = v[0];
+        glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, v); s->read_framebuffer = v[0];
+    }
+    if (!(s->known & SHADOW_ACTIVE_TEXTURE)) { glGetIntegerv(GL_ACTIVE_TEXTURE, v); s->active_texture = v[0]; }
+    if (!(s->known & SHADOW_TEXTURE_2D)) {
+        REAL(PFNGLACTIVETEXTUREPROC, glActiveTexture);
+        if (s->active_texture != GL_TEXTURE0) real_glActiveTexture(GL_TEXTURE0);
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, v);
+        s->texture_2d = v[0];
+        if (s->active_texture != GL_TEXTURE0) real_glActiveTexture(s->active_texture);
+    }
+    if (!(s->known & SHADOW_BLEND)) s->blend = glIsEnabled(GL_BLEND);
+    if (!(s->known & SHADOW_CULL_FACE)) s->cull_face = glIsEnabled(GL_CULL_FACE);
+    if (!(s->known & SHADOW_DEPTH_TEST)) s->depth_test = glIsEnabled(GL_DEPTH_TEST);
+    if (!(s->known & SHADOW_SCISSOR_TEST)) s->scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+    if (!(s->known & SHADOW_BLEND_FUNC)) {
+        glGetIntegerv(GL_BLEND_SRC_RGB, v); s->blend_src_rgb = v[0];
+        glGetIntegerv(GL_BLEND_DST_RGB, v); s->blend_dst_rgb = v[0];
+        glGetIntegerv(GL_BLEND_SRC_ALPHA, v); s->blend_src_alpha = v[0];
+        glGetIntegerv(GL_BLEND_DST_ALPHA, v); s->blend_dst_alpha = v[0];
+    }
+    if (!(s->known & SHADOW_VIEWPORT)) glGetIntegerv(GL_VIEWPORT, s->viewport);
+    s->known = SHADOW_ALL;
+    return s;
+}
+
+static void set_enabled(GLenum cap, GLboolean value) {
+    REAL(void (*)(GLenum), glEnable);
+    REAL(void (*)(GLenum), glDisable);
+    if (value) real_glEnable(cap);
+    else real_glDisable(cap);
+}
+
+void gl_shadow_restore(const GLShadowState& s) {
+    REAL(PFNGLUSEPROGRAMPROC, glUseProgram);
+    REAL(PFNGLBINDVERTEXARRAYPROC, glBindVertexArray);
+    REAL(PFNGLBINDBUFFERPROC, glBindBuffer);
+    REAL(PFNGLBINDFRAMEBUFFERPROC, glBindFramebuffer);
+    REAL(PFNGLACTIVETEXTUREPROC, glActiveTexture);
+    REAL(PFNGLBINDTEXTUREEXTPROC, glBindTexture);
+    REAL(PFNGLBLENDFUNCSEPARATEPROC, glBlendFuncSeparate);
+    REAL(void (*)(GLint, GLint, GLsizei, GLsizei), glViewport);
+
+    real_glUseProgram(s.program);
+    real_glBindVertexArray(s.vertex_array);
+    real_glBindBuffer(GL_ARRAY_BUFFER, s.array_buffer);
+    real_glBindFramebuffer(GL_DRAW_FRAMEBUFFER, s.draw_framebuffer);
+    real_glBindFramebuffer(GL_READ_FRAMEBUFFER, s.read_framebuffer);
+    real_glActiveTexture(GL_TEXTURE0);
+    real_glBindTexture(GL_TEXTURE_2D, s.texture_2d);
+    real_glActiveTexture(s.active_texture);
+    set_enabled(GL_BLEND, s.blend);
+    set_enabled(GL_CULL_FACE, s.cull_face);
+    set_enabled(GL_DEPTH_TEST, s.depth_test);
+    set_enabled(GL_SCISSOR_TEST, s.scissor_test);
+    real_glBlendFuncSeparate(s.blend_src_rgb, s.blend_dst_rgb, s.blend_src_alpha, s.blend_dst_alpha);
+    real_glViewport(s.viewport[0], s.viewport[1], s.viewport[2], s.viewport[3]);
+}
+
+void gl_shadow_verify() {
+    static const bool enabled = getenv("OVERLAY_SHADOW_VERIFY") != nullptr;
+    static int reported = 0;
+    const GLShadowState* s = current;
+    if (!enabled || !s || reported >= 32) return;
+
+    GLint v[4];
+    auto check = [&](uint32_t field, const char* name, GLint expected, GLint actual) {
+        if (!(s->known & field) || expected == actual || reported >= 32) return;
+        std::cerr << "Overlay Error: Shadow state mismatch for " << name << ": tracked "
+                  << expected << ", driver " << actual << std::endl;
+        ++reported;
+    };
+    glGetIntegerv(GL_CURRENT_PROGRAM, v); check(SHADOW_PROGRAM, "program", s->program, v[0]);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, v); check(SHADOW_VERTEX_ARRAY, "vertex array", s->vertex_array, v[0]);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, v); check(SHADOW_ARRAY_BUFFER, "array buffer", s->array_buffer, v[0]);
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, v); check(SHADOW_FRAMEBUFFER, "draw framebuffer", s->draw_framebuffer, v[0]);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, v); check(SHADOW_FRAMEBUFFER, "read framebuffer", s->read_framebuffer, v[0]);
+    glGetIntegerv(GL_ACTIVE_TEXTURE, v); check(SHADOW_ACTIVE_TEXTURE, "active texture", s->active_texture, v[0]);
+    if ((s->known & SHADOW_ACTIVE_TEXTURE) && s->active_texture == GL_TEXTURE0) {
+        glGetIntegerv(GL_TEXTURE_BINDING_2D, v); check(SHADOW_TEXTURE_2D, "texture 2D", s->texture_2d, v[0]);
+    }
+    check(SHADOW_BLEND, "blend", s->blend, glIsEnabled(GL_BLEND));
+    check(SHADOW_CULL_FACE, "cull face", s->cull_face, glIsEnabled(GL_CULL_FACE));
+    check(SHADOW_DEPTH_TEST, "depth test", s->depth_test, glIsEnabled(GL_DEPTH_TEST));
+    check(SHADOW_SCISSOR_TEST, "scissor test", s->scissor_test, glIsEnabled(GL_SCISSOR_TEST));
+    glGetIntegerv(GL_BLEND_SRC_RGB, v); check(SHADOW_BLEND_FUNC, "blend src rgb", s->blend_src_rgb, v[0]);
+    glGetIntegerv(GL_BLEND_DST_RGB, v); check(SHADOW_BLEND_FUNC, "blend dst rgb", s->blend_dst_rgb, v[0]);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, v); check(SHADOW_BLEND_FUNC, "blend src alpha", s->blend_src_alpha, v[0]);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, v); check(SHADOW_BLEND_FUNC, "blend dst alpha", s->blend_dst_alpha, v[0]);
+    glGetIntegerv(GL_VIEWPORT, v);
+    for (int i = 0; i < 4; ++i) check(SHADOW_VIEWPORT, "viewport", s->viewport[i], v[i]);
+}
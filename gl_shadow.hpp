@@ -0,0 +1,76 @@
+#ifndef GL_SHADOW_HPP
+#define GL_SHADOW_HPP
+
+#include <GL/gl.h>
+#include <GL/glx.h>
+#include <cstdint>
+
+// Shadow copy of the GL state the overlay disturbs, kept per GLX context by
+// interposing the application's state setters (directly linked or resolved
+// through glXGetProcAddress). Restoring from it after the overlay draws needs
+// no glGet round trips. State changed through paths we can't follow
+// (glPopAttrib, display lists, indexed enables, ARB/EXT/APPLE aliases...) is
+// marked unknown and queried once the next time it's needed.
+enum ShadowField : uint32_t {
+    SHADOW_PROGRAM        = 1 << 0,
+    SHADOW_VERTEX_ARRAY   = 1 << 1,
+    SHADOW_ARRAY_BUFFER   = 1 << 2,
+    SHADOW_FRAMEBUFFER    = 1 << 3,
+    SHADOW_ACTIVE_TEXTURE = 1 << 4,
+    SHADOW_TEXTURE_2D     = 1 << 5, // Binding on texture unit 0, the only unit the overlay uses
+    SHADOW_BLEND          = 1 << 6,
+    SHADOW_CULL_FACE      = 1 << 7,
+    SHADOW_DEPTH_TEST     = 1 << 8,
+    SHADOW_SCISSOR_TEST   = 1 << 9,
+    SHADOW_BLEND_FUNC     = 1 << 10,
+    SHADOW_VIEWPORT       = 1 << 11,
+    SHADOW_ALL            = (1 << 12) - 1,
+};
+
+struct GLShadowState {
+    GLuint program = 0;
+    GLuint vertex_array = 0;
+    GLuint array_buffer = 0;
+    GLuint draw_framebuffer = 0;
+    GLuint read_framebuffer = 0;
+    GLenum active_texture = GL_TEXTURE0;
+    GLuint texture_2d = 0;
+    GLboolean blend = GL_FALSE;
+    GLboolean cull_face = GL_FALSE;
+    GLboolean depth_test = GL_FALSE;
+    GLboolean scissor_test = GL_FALSE;
+    GLenum blend_src_rgb = GL_ONE, blend_dst_rgb = GL_ZERO;
+    GLenum blend_src_alpha = GL_ONE, blend_dst_alpha = GL_ZERO;
+    GLint viewport[4] = {0, 0, 0, 0};
+    // Fields that match the driver. A new context starts with GL's defaults,
+    // which are known, except for the viewport (the drawable size).
+    uint32_t known = SHADOW_ALL & ~SHADOW_VIEWPORT;
+};
+
+// Shadow for the calling thread's current context, with any unknown fields
+// queried from the driver first. Returns nullptr if no tracked context is current.
+const GLShadowState* gl_shadow_sync();
+
+// While suspended (the overlay's own drawing), the interposed setters just
+// forward to the driver without touching the shadow
+void gl_shadow_suspend();
+void gl_shadow_resume();
+
+// Puts the application's state back from the shadow. Call while suspended.
+void gl_shadow_restore(const GLShadowState& state);
+
+// With OVERLAY_SHADOW_VERIFY set, compares every known field against the driver
+// and reports mismatches; used to validate the tracker on a given title
+void gl_shadow_verify();
+
+// Share group of a context the application created, or 0 if it predates the
+// library or is one of the overlay's own. Contexts in one group share buffers,
+// textures and programs, but not container objects (VAOs, FBOs).
+unsigned gl_share_group(GLXContext context);
+// Whether any application context in `group` still exists
+bool gl_share_group_alive(unsigned group);
+// `callback` runs after the application destroys a context, on that thread,
+// with the group the context was in
+void gl_shadow_on_destroy(void (*callback)(GLXContext context, unsigned share_group));
+
+#endif // GL_SHADOW_HPP
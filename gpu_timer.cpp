@@ -0,0 +1,36 @@
+#include "gpu_timer.hpp"
+
+void GpuTimer::init() {
+    // Names from a destroyed context are gone with it, results and all
+    for (bool& slot : pending) slot = false;
+    begun = false;
+    glGenQueries(LATENCY, begin_queries);
+    glGenQueries(LATENCY, end_queries);
+    initialized = true;
+}
+
+void GpuTimer::frame_begin() {
+    if (!initialized) return;
+    // Slot about to be reused: harvest it if the GPU is done, otherwise drop it
+    if (pending[index]) {
+        GLint available = 0;
+        glGetQueryObjectiv(end_queries[index], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 begin_ns = 0, end_ns = 0;
+            glGetQueryObjectui64v(begin_queries[index], GL_QUERY_RESULT, &begin_ns);
+            glGetQueryObjectui64v(end_queries[index], GL_QUERY_RESULT, &end_ns);
+            if (end_ns > begin_ns) gpu_ms = (end_ns - begin_ns) / 1e6f;
+        }
+        pending[index] = false;
+    }
+    glQueryCounter(begin_queries[index], GL_TIMESTAMP);
+    begun = true;
+}
+
+void GpuTimer::frame_end() {
+    if (!initialized || !begun) return;
+    glQueryCounter(end_queries[index], GL_TIMESTAMP);
+    pending[index] = true;
+    begun = false;
+    index = (index + 1) % LATENCY;
+}
@@ -0,0 +1,34 @@
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+
+#include <GL/glew.h>
+
+// Measures GPU time per frame with GL_TIMESTAMP queries: one issued right after
+// the real swap returns (the GPU starts the next frame) and one at the next hook
+// entry (the GPU has consumed the frame). Results are read back a few frames
+// later without ever waiting on the GPU.
+class GpuTimer {
+public:
+    static constexpr int LATENCY = 4; // Frames in flight before a result is read
+
+    // Creates the queries in the current context. Queries aren't shared, so
+    // the timer stays with that context; once it is destroyed, calling init()
+    // again moves the timer to another one and keeps the last result.
+    void init();
+    void frame_begin(); // Call right after the real swap
+    void frame_end();   // Call on hook entry, before the overlay draws
+
+    // Most recent resolved GPU frame time, or 0 until the first result arrives
+    float last_gpu_ms() const { return gpu_ms; }
+
+private:
+    GLuint begin_queries[LATENCY] = {};
+    GLuint end_queries[LATENCY] = {};
+    bool pending[LATENCY] = {};
+    bool begun = false;
+    int index = 0;
+    float gpu_ms = 0.0f;
+    bool initialized = false;
+};
+
+#endif // GPU_TIMER_HPP
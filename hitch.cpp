@@ -0,0 +1,113 @@
+#include "hitch.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+HitchDetector::~HitchDetector() {
+    close();
+}
+
+bool HitchDetector::open(const char* path, uint32_t max_hitches, float threshold_factor) {
+    close();
+    threshold = threshold_factor;
+    max_hitches = std::min(std::max(max_hitches, 1u), MAX_HITCHES);
+    map_size = sizeof(HitchFileHeader) + sizeof(HitchDump) * max_hitches;
+
+    fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Overlay Error: Could not create hitch log " << path << std::endl;
+        return false;
+    }
+    // Reserve the whole file up front so a hitch never has to grow it. A sparse
+    // file would do for the mapping, but writing a dump into it on a full disk
+    // raises SIGBUS, so without real blocks there is no flight recorder.
+    if (int error = posix_fallocate(fd, 0, map_size)) {
+        std::cerr << "Overlay Error: Could not preallocate hitch log " << path << ": " << strerror(error) << std::endl;
+        close();
+        return false;
+    }
+    void* map = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        std::cerr << "Overlay Error: Could not map hitch log " << path << std::endl;
+        close();
+        return false;
+    }
+    header = static_cast<HitchFileHeader*>(map);
+    dumps = reinterpret_cast<HitchDump*>(static_cast<unsigned char*>(map) + sizeof(HitchFileHeader));
+
+    timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    std::memcpy(header->magic, "OVHT", 4);
+    header->version = 2; // 2: SystemSample gained mem_usage and gpu_busy
+    header->dump_size = sizeof(HitchDump);
+    header->max_hitches = max_hitches;
+    header->hitch_count = 0;
+    header->dropped = 0;
+    header->threshold = threshold;
+    header->wall_clock_ns = (int64_t)wall.tv_sec * 1000000000LL + wall.tv_nsec;
+    header->steady_clock_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+
+    std::cout << "Overlay: Recording hitches (> " << threshold << "x median) to " << path << std::endl;
+    return true;
+}
+
+bool HitchDetector::record(const FrameRecord& frame, const SystemSample& sample) {
+    // Rolling median of the frames before this one, from a fixed scratch array
+    size_t window = std::min(history_count, MEDIAN_WINDOW);
+    float median = 0.0f;
+    if (window == MEDIAN_WINDOW) {
+        for (size_t i = 0; i < window; i++) {
+            median_scratch[i] = history[(history_head + HISTORY - 1 - i) % HISTORY].frame_ms;
+        }
+        std::nth_element(median_scratch, median_scratch + window / 2, median_scratch + window);
+        median = median_scratch[window / 2];
+    }
+
+    history[history_head] = frame;
+    history_head = (history_head + 1) % HISTORY;
+    if (history_count < HISTORY) history_count++;
+
+    if (median <= 0.0f || frame.frame_ms <= median * threshold) return false;
+    total_hitches++;
+    if (!header) return true;
+
+    uint32_t slot = next_slot.fetch_add(1, std::memory_order_relaxed);
+    if (slot >= header->max_hitches) {
+        __atomic_fetch_add(&header->dropped, 1, __ATOMIC_RELAXED);
+        return true;
+    }
+
+    // Write straight into the mapped page cache; the kernel does the I/O
+    HitchDump& dump = dumps[slot];
+    dump.hitch = frame;
+    dump.median_ms = median;
+    dump.frame_count = (uint32_t)history_count;
+    dump.sample = sample;
+    size_t oldest = (history_head + HISTORY - history_count) % HISTORY;
+    size_t first_run = std::min(history_count, HISTORY - oldest);
+    std::memcpy(dump.frames, history + oldest, first_run * sizeof(FrameRecord));
+    std::memcpy(dump.frames + first_run, history, (history_count - first_run) * sizeof(FrameRecord));
+
+    // Publish only once the dump is complete, so a reader never sees a torn record
+    __atomic_fetch_add(&header->hitch_count, 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+void HitchDetector::close() {
+    if (header) {
+        msync(header, map_size, MS_SYNC);
+        munmap(header, map_size);
+        header = nullptr;
+        dumps = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef HITCH_HPP
+#define HITCH_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+#include "stats.hpp"
+
+// Flags frames slower than `threshold` x the rolling median frametime and dumps
+// the recent frame history plus the latest collector values to a preallocated,
+// memory-mapped file. record() never allocates, locks or makes a syscall.
+class HitchDetector {
+public:
+    static constexpr size_t HISTORY = 128;       // Frames kept and dumped per hitch
+    static constexpr size_t MEDIAN_WINDOW = 64;  // Frames the rolling median is taken over
+    static constexpr uint32_t MAX_HITCHES = 4096; // Upper bound for max_hitches, about 13 MB of dumps
+
+    // On-disk layout: HitchFileHeader, then up to max_hitches HitchDump records
+    struct HitchFileHeader {
+        char magic[4];              // "OVHT"
+        uint32_t version;
+        uint32_t dump_size;         // sizeof(HitchDump)
+        uint32_t max_hitches;
+        uint32_t hitch_count;       // Number of valid dumps, updated atomically
+        uint32_t dropped;           // Hitches seen after the file filled up
+        float threshold;
+        uint32_t reserved;
+        int64_t wall_clock_ns;      // CLOCK_REALTIME at open...
+        uint64_t steady_clock_ns;   // ...and the matching steady_clock time, to map timestamps to wall time
+    };
+
+    struct HitchDump {
+        FrameRecord hitch;
+        float median_ms;
+        uint32_t frame_count;       // Valid entries in frames[]
+        SystemSample sample;
+        FrameRecord frames[HISTORY]; // Oldest first, ending with the hitch frame
+    };
+
+    ~HitchDetector();
+
+    // max_hitches is clamped to 1..MAX_HITCHES
+    bool open(const char* path, uint32_t max_hitches, float threshold);
+    // Returns true when the frame was flagged as a hitch
+    bool record(const FrameRecord& frame, const SystemSample& sample);
+    void close();
+
+    uint32_t hitch_count() const { return total_hitches; }
+
+private:
+    HitchFileHeader* header = nullptr;
+    HitchDump* dumps = nullptr;
+    size_t map_size = 0;
+    int fd = -1;
+    float threshold = 0.0f;
+    std::atomic<uint32_t> next_slot{0};
+    uint32_t total_hitches = 0;
+
+    FrameRecord history[HISTORY];
+    size_t history_head = 0;   // Index the next frame is written to
+    size_t history_count = 0;
+    float median_scratch[MEDIAN_WINDOW];
+};
+
+#endif // HITCH_HPP
@@ -0,0 +1,347 @@
+#include "layout.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+static const char* const frame_value_names[VALUE_METRIC_FIRST] = {
+    "fps", "frame_ms", "app_ms", "wait_ms", "gpu_ms",
+};
+
+const char* layout_value_name(LayoutValue value) {
+    if (value < VALUE_METRIC_FIRST) return frame_value_names[value];
+    if (value < VALUE_COUNT) return metric_info[value - VALUE_METRIC_FIRST].name;
+    return "";
+}
+
+static LayoutValue find_value(const std::string& name) {
+    for (int v = 0; v < VALUE_COUNT; ++v) {
+        if (name == layout_value_name((LayoutValue)v)) return (LayoutValue)v;
+    }
+    return VALUE_NONE;
+}
+
+const char* Layout::default_widget() {
+    return "text 1000 FPS: {fps:0} | CPU: {cpu_usage:1}% | App: {app_ms:2}ms | Wait: {wait_ms:2}ms";
+}
+
+// --- Compilation, once at load ---
+bool Layout::compile(std::vector<WidgetSpec> widgets, const std::vector<AlertSpec>& alerts, TextBatch& batch, uint32_t color) {
+    rgba = color;
+    for (const AlertSpec& alert : alerts) compile_alert(alert);
+
+    if (widgets.empty()) widgets.push_back(WidgetSpec{0, default_widget()});
+    std::stable_sort(widgets.begin(), widgets.end(),
+                     [](const WidgetSpec& a, const WidgetSpec& b) { return a.index < b.index; });
+
+    interval = 0;
+    for (const WidgetSpec& widget : widgets) {
+        std::string name = "widget" + std::to_string(widget.index);
+        std::istringstream iss(widget.definition);
+        std::string type;
+        long rate = -1;
+        iss >> type >> rate;
+        if (rate < 0) {
+            std::cerr << "Overlay Error: " << name << ": expected '<type> <rate_ms> ...'" << std::endl;
+            continue;
+        }
+
+        DrawOp op = {};
+        op.rate_ms = std::max<uint32_t>((uint32_t)rate, MIN_RATE_MS);
+        op.value = VALUE_NONE;
+        op.label_run = -1;
+        if (type == "text") {
+            op.kind = OP_TEXT;
+            std::string format;
+            std::getline(iss >> std::ws, format);
+            if (!compile_text(op, format, name)) continue;
+        } else if (type == "graph") {
+            op.kind = OP_GRAPH;
+            std::string value_name;
+            iss >> value_name;
+            op.value = find_value(value_name);
+            if (op.value == VALUE_NONE) {
+                std::cerr << "Overlay Error: " << name << ": unknown value '" << value_name << "'" << std::endl;
+                continue;
+            }
+            if (!(iss >> op.max) || op.max < 0.0f) op.max = 0.0f;
+            op.history_first = (uint32_t)history.size();
+            history.resize(history.size() + GRAPH_SAMPLES, 0.0f);
+            history_colors.resize(history.size(), rgba);
+        } else if (type == "bar" || type == "gauge") {
+            op.kind = type == "bar" ? OP_BAR : OP_GAUGE;
+            std::string value_name, label;
+            iss >> value_name;
+            op.value = find_value(value_name);
+            if (op.value == VALUE_NONE) {
+                std::cerr << "Overlay Error: " << name << ": unknown value '" << value_name << "'" << std::endl;
+                continue;
+            }
+            if (!(iss >> op.max) || op.max <= 0.0f) op.max = 100.0f;
+            std::getline(iss >> std::ws, label);
+            if (!label.empty()) {
+                op.label_first = (uint32_t)literals.size();
+                op.label_length = (uint32_t)label.size();
+                literals += label;
+                op.label_run = batch.add_run();
+                batch.set_color(op.label_run, rgba);
+            }
+        } else if (type == "heatmap") {
+            op.kind = OP_HEATMAP;
+            long columns = DEFAULT_COLUMNS;
+            iss >> columns;
+            op.columns = (uint32_t)std::max(columns, 1L);
+            cores = true;
+            core_count = get_core_count();
+        } else {
+            std::cerr << "Overlay Error: " << name << ": unknown widget type '" << type << "'" << std::endl;
+            continue;
+        }
+
+        op.run = batch.add_run();
+        batch.set_color(op.run, rgba);
+        interval = interval ? std::min(interval, op.rate_ms) : op.rate_ms;
+        ops.push_back(op);
+    }
+    if (!interval) interval = 1000;
+    return !ops.empty();
+}
+
+// Splits a format into literal text and {value:decimals} fields. A brace
+// that doesn't open a known field is kept as text.
+bool Layout::compile_text(DrawOp& op, const std::string& format, const std::string& name) {
+    op.segment_first = (uint32_t)segments.size();
+    FormatSegment segment = { (uint32_t)literals.size(), 0, VALUE_NONE, 0 };
+    for (size_t i = 0; i < format.size();) {
+        size_t close = format[i] == '{' ? format.find('}', i) : std::string::npos;
+        if (close != std::string::npos) {
+            std::string field = format.substr(i + 1, close - i - 1);
+            size_t colon = field.find(':');
+            LayoutValue value = find_value(field.substr(0, colon));
+            if (value != VALUE_NONE) {
+                segment.value = value;
+                segment.decimals = colon == std::string::npos ? 0 : (uint8_t)std::min(std::atoi(field.c_str() + colon + 1), 6);
+                segments.push_back(segment);
+                segment = { (uint32_t)literals.size(), 0, VALUE_NONE, 0 };
+                i = close + 1;
+                continue;
+            }
+            std::cerr << "Overlay Error: " << name << ": unknown value in '{" << field << "}'" << std::endl;
+        }
+        literals += format[i++];
+        segment.literal_length++;
+    }
+    if (segment.literal_length) segments.push_back(segment);
+    op.segment_count = (uint32_t)segments.size() - op.segment_first;
+    return op.segment_count > 0;
+}
+
+// Rules are "<op> <threshold> <color>", comma separated, with op < or >
+bool Layout::compile_alert(const AlertSpec& alert) {
+    LayoutValue value = find_value(alert.value);
+    if (value == VALUE_NONE || rule_count[value]) {
+        std::cerr << "Overlay Error: alert_" << alert.value << ": unknown or repeated value" << std::endl;
+        return false;
+    }
+    rule_first[value] = (uint16_t)rules.size();
+    std::istringstream list(alert.rules);
+    std::string text;
+    while (std::getline(list, text, ',')) {
+        std::istringstream iss(text);
+        char op = 0;
+        std::string color;
+        AlertRule rule;
+        iss >> op >> rule.threshold >> color;
+        rule.below = op == '<';
+        rule.rgba = parse_rgba(color);
+        if ((op != '<' && op != '>') || iss.fail() || !rule.rgba) {
+            std::cerr << "Overlay Error: alert_" << alert.value << ": expected '< 50 #ff3030', got '" << text << "'" << std::endl;
+            continue;
+        }
+        rules.push_back(rule);
+    }
+    rule_count[value] = (uint16_t)(rules.size() - rule_first[value]);
+    alert_value[value] = NAN; // Evaluated on the first sample
+    return rule_count[value] > 0;
+}
+
+void Layout::update_alerts(const LayoutInputs& inputs) {
+    for (int v = 0; v < VALUE_COUNT; ++v) {
+        if (!rule_count[v] || inputs.values[v] == alert_value[v]) continue;
+        float value = inputs.values[v];
+        alert_value[v] = value;
+        alert_color[v] = 0;
+        for (const AlertRule* rule = &rules[rule_first[v]]; rule != &rules[rule_first[v]] + rule_count[v]; ++rule) {
+            if (rule->below ? value < rule->threshold : value > rule->threshold) {
+                alert_color[v] = rule->rgba;
+                break;
+            }
+        }
+    }
+}
+
+// --- Placement, on load and when the drawable is resized ---
+void Layout::place(float x, float y, float align_x, float align_y, float text_scale, float line_height) {
+    scale = text_scale;
+    float total = 0.0f;
+    for (DrawOp& op : ops) {
+        switch (op.kind) {
+            case OP_TEXT:
+                op.height = line_height * scale;
+                op.width = 0.0f; // Measured by the batch
+                break;
+            case OP_GRAPH:
+                op.height = (GRAPH_HEIGHT + ROW_GAP) * scale;
+                op.width = GRAPH_WIDTH * scale;
+                break;
+            case OP_BAR:
+            case OP_GAUGE:
+                op.height = line_height * scale;
+                op.width = ((op.label_run >= 0 ? LABEL_WIDTH : 0.0f) + BAR_WIDTH) * scale;
+                break;
+            case OP_HEATMAP: {
+                uint32_t rows = (core_count + op.columns - 1) / op.columns;
+                op.height = (rows * (CELL_SIZE + CELL_GAP) + ROW_GAP) * scale;
+                op.width = std::min<uint32_t>(op.columns, core_count) * (CELL_SIZE + CELL_GAP) * scale;
+                break;
+            }
+        }
+        total += op.height;
+    }
+    float row_y = y - align_y * total;
+    for (DrawOp& op : ops) {
+        op.x = x;
+        op.y = row_y;
+        op.align_x = align_x;
+        op.next_update_ms = 0;
+        row_y += op.height;
+    }
+}
+
+// --- Per frame ---
+void Layout::update(uint64_t now_ms, const LayoutInputs& inputs, TextBatch& batch) {
+    for (DrawOp& op : ops) {
+        if (now_ms < op.next_update_ms) continue;
+        op.next_update_ms = now_ms + op.rate_ms;
+        switch (op.kind) {
+            case OP_TEXT: update_text(op, inputs, batch); break;
+            case OP_GRAPH: update_graph(op, inputs, batch); break;
+            case OP_BAR:
+            case OP_GAUGE: update_bar(op, inputs, batch); break;
+            case OP_HEATMAP: update_heatmap(op, inputs, batch); break;
+        }
+    }
+}
+
+// Formats with std::to_chars rather than snprintf: no locale, no format
+// string to interpret, and the digits land straight in the text buffer. The
+// batch then only rewrites the instances of digits that changed.
+void Layout::update_text(DrawOp& op, const LayoutInputs& inputs, TextBatch& batch) {
+    char text[256];
+    char* end = text;
+    char* const last = text + sizeof(text) - 1;
+    ColorSpan spans[32]; // Alerting fields
+    size_t span_count = 0;
+    for (uint32_t i = op.segment_first; i < op.segment_first + op.segment_count; ++i) {
+        const FormatSegment& segment = segments[i];
+        size_t n = std::min<size_t>(segment.literal_length, last - end);
+        memcpy(end, literals.data() + segment.literal_first, n);
+        end += n;
+        if (segment.value != VALUE_NONE) {
+            char* field = end;
+            std::to_chars_result result = std::to_chars(end, last, inputs.values[segment.value], std::chars_format::fixed, segment.decimals);
+            if (result.ec == std::errc()) end = result.ptr;
+            if (alert_color[segment.value] && span_count < 32) {
+                spans[span_count++] = ColorSpan{(uint32_t)(field - text), (uint32_t)(end - text), alert_color[segment.value]};
+            }
+        }
+    }
+    *end = '\0';
+    batch.set_align(op.run, op.align_x, 0.0f);
+    batch.set_spans(op.run, spans, span_count);
+    batch.set_text(op.run, text, op.x, op.y, scale);
+}
+
+// One column per sample, oldest on the left
+void Layout::update_graph(DrawOp& op, const LayoutInputs& inputs, TextBatch& batch) {
+    float* samples = history.data() + op.history_first;
+    uint32_t* colors = history_colors.data() + op.history_first;
+    samples[op.history_head] = inputs.values[op.value];
+    colors[op.history_head] = color_of(op.value);
+    op.history_head = (op.history_head + 1) % GRAPH_SAMPLES;
+
+    float max = op.max;
+    if (max <= 0.0f) max = *std::max_element(samples, samples + GRAPH_SAMPLES);
+    float column = op.width / GRAPH_SAMPLES;
+    float left = op.x - op.align_x * op.width;
+    float bottom = op.y + GRAPH_HEIGHT * scale;
+    quads.clear();
+    for (int i = 0; i < GRAPH_SAMPLES; ++i) {
+        int slot = (op.history_head + i) % GRAPH_SAMPLES;
+        float h = max > 0.0f ? std::min(samples[slot] / max, 1.0f) * GRAPH_HEIGHT * scale : 0.0f;
+        quads.push_back(solid_quad(left + i * column, bottom - h, column, h, colors[slot]));
+    }
+    batch.set_quads(op.run, quads.data(), quads.size());
+}
+
+// The widget color at a fraction of its alpha, for unlit parts
+static uint32_t dimmed(uint32_t rgba) {
+    uint32_t alpha = (rgba >> 24) * 3 / 10;
+    return (rgba & 0x00FFFFFF) | alpha << 24;
+}
+
+// Green when idle through yellow to red when saturated
+static uint32_t heat_color(float usage) {
+    float t = std::min(std::max(usage / 100.0f, 0.0f), 1.0f);
+    if (t < 0.5f) return pack_rgba(0.2f + 1.4f * t, 0.8f, 0.2f - 0.2f * t);
+    return pack_rgba(0.9f, 0.8f - 1.2f * (t - 0.5f), 0.1f);
+}
+
+// Optional label, then a track with the filled share of it on top (bar) or
+// GAUGE_SEGMENTS segments of which that share is lit (gauge). The instance
+// count never changes, so updates patch the batch in place.
+void Layout::update_bar(DrawOp& op, const LayoutInputs& inputs, TextBatch& batch) {
+    float left = op.x - op.align_x * op.width;
+    if (op.label_run >= 0) {
+        char label[128];
+        size_t length = std::min<size_t>(op.label_length, sizeof(label) - 1);
+        memcpy(label, literals.data() + op.label_first, length);
+        label[length] = '\0';
+        batch.set_text(op.label_run, label, left, op.y, scale);
+        left += LABEL_WIDTH * scale;
+    }
+    float fraction = std::min(std::max(inputs.values[op.value] / op.max, 0.0f), 1.0f);
+    uint32_t fill = color_of(op.value);
+    float width = BAR_WIDTH * scale, height = BAR_HEIGHT * scale;
+    float top = op.y + (op.height - height) * 0.5f;
+    quads.clear();
+    if (op.kind == OP_BAR) {
+        quads.push_back(solid_quad(left, top, width, height, dimmed(rgba)));
+        quads.push_back(solid_quad(left, top, width * fraction, height, fill));
+    } else {
+        float gap = SEGMENT_GAP * scale;
+        float segment = (width - gap * (GAUGE_SEGMENTS - 1)) / GAUGE_SEGMENTS;
+        int lit = (int)std::lround(fraction * GAUGE_SEGMENTS);
+        for (int i = 0; i < GAUGE_SEGMENTS; ++i) {
+            quads.push_back(solid_quad(left + i * (segment + gap), top, segment, height, i < lit ? fill : dimmed(rgba)));
+        }
+    }
+    batch.set_quads(op.run, quads.data(), quads.size());
+}
+
+// One cell per logical CPU, row by row
+void Layout::update_heatmap(DrawOp& op, const LayoutInputs& inputs, TextBatch& batch) {
+    float left = op.x - op.align_x * op.width;
+    float cell = CELL_SIZE * scale, pitch = (CELL_SIZE + CELL_GAP) * scale;
+    quads.clear();
+    for (int core = 0; core < core_count; ++core) {
+        float usage = core < (int)inputs.core_usage.size() ? inputs.core_usage[core] : 0.0f;
+        float x = left + (core % op.columns) * pitch;
+        float y = op.y + (core / op.columns) * pitch;
+        quads.push_back(solid_quad(x, y, cell, cell, heat_color(usage)));
+    }
+    batch.set_quads(op.run, quads.data(), quads.size());
+}
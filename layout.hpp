@@ -0,0 +1,169 @@
+#ifndef LAYOUT_HPP
+#define LAYOUT_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "stats.hpp"
+#include "text_batch.hpp"
+
+// Everything a widget can show, by the name it has in the config
+enum LayoutValue : uint8_t {
+    VALUE_FPS,
+    VALUE_FRAME_MS,
+    VALUE_APP_MS,
+    VALUE_WAIT_MS,
+    VALUE_GPU_MS,
+    VALUE_METRIC_FIRST, // Collector metrics follow, in MetricId order
+    VALUE_COUNT = VALUE_METRIC_FIRST + METRIC_COUNT,
+    VALUE_NONE = 0xFF
+};
+
+const char* layout_value_name(LayoutValue value);
+
+// What widgets read, refreshed on the layout's interval
+struct LayoutInputs {
+    float values[VALUE_COUNT] = {}; // By LayoutValue
+    std::vector<float> core_usage;  // Percent per logical CPU, only kept if wants_cores()
+};
+
+// One "widget<index> = <definition>" line from the config
+struct WidgetSpec {
+    int index;
+    std::string definition;
+};
+
+// One "alert_<value> = <rules>" line from the config
+struct AlertSpec {
+    std::string value;
+    std::string rules;
+};
+
+// The widgets the config declares, stacked in rows in index order:
+//
+//   widget0 = text 1000 FPS: {fps:0} | CPU: {cpu_usage:1}%
+//   widget1 = graph 100 frame_ms 33.3
+//   widget2 = bar 250 mem_usage 100 MEM
+//   widget3 = gauge 250 gpu_busy 100 GPU
+//   widget4 = heatmap 500 16
+//
+// A text widget is a format with {value:decimals} fields; a graph plots the
+// last GRAPH_SAMPLES values of one value against a fixed maximum, or against
+// the largest sample if none is given. Bars fill in proportion to a value
+// over a maximum and gauges light that share of GAUGE_SEGMENTS segments,
+// both after an optional label. A heatmap has one cell per logical CPU, in
+// rows of the given number of columns, colored by its utilization. The
+// number after the type is the update rate in ms.
+//
+// Alerts recolor a value wherever it is shown: its digits in text, the fill
+// of bars and gauges, and graph columns sampled while it alerted. Rules are
+// tried in order and the first match wins:
+//
+//   alert_fps = < 30 #ff3030, < 50 #ffa020
+//   alert_cpu_usage = > 90 #ff8000
+//
+// They are evaluated when a sampled value changes, not per frame.
+//
+// Definitions are compiled once into flat arrays of POD draw ops and format
+// segments, so the per-frame update is a loop over due ops with no parsing
+// or lookups. Everything it produces, shapes included, goes into the shared
+// TextBatch as per-instance colored quads: however many cores a heatmap
+// shows, the overlay stays one draw call.
+class Layout {
+public:
+    static constexpr uint32_t MIN_RATE_MS = 50;
+    static constexpr int GRAPH_SAMPLES = 120;
+    static constexpr float GRAPH_WIDTH = 240.0f;  // Pixels at text scale 1
+    static constexpr float GRAPH_HEIGHT = 40.0f;
+    static constexpr float ROW_GAP = 4.0f;
+    static constexpr float LABEL_WIDTH = 48.0f;   // Column for bar and gauge labels
+    static constexpr float BAR_WIDTH = 160.0f;
+    static constexpr float BAR_HEIGHT = 12.0f;
+    static constexpr int GAUGE_SEGMENTS = 10;
+    static constexpr float SEGMENT_GAP = 2.0f;
+    static constexpr float CELL_SIZE = 10.0f;     // Heatmap cells
+    static constexpr float CELL_GAP = 2.0f;
+    static constexpr int DEFAULT_COLUMNS = 16;
+
+    // Compiles the widgets, adding their runs to `batch` in `rgba`. Broken
+    // definitions are reported and skipped; returns false if none is left.
+    bool compile(std::vector<WidgetSpec> widgets, const std::vector<AlertSpec>& alerts, TextBatch& batch, uint32_t rgba);
+    // The definition used when the config declares no widgets
+    static const char* default_widget();
+
+    // Fastest update rate of any widget: how often values must be refreshed
+    uint32_t interval_ms() const { return interval; }
+    // Whether some widget shows per-core usage, which costs a longer /proc/stat parse
+    bool wants_cores() const { return cores; }
+
+    // Stacks the rows so point (align_x, align_y) of the whole block lands on
+    // (x, y), at `scale` times the base size; every widget updates next frame
+    void place(float x, float y, float align_x, float align_y, float scale, float line_height);
+    // Re-evaluates the alerts of values that changed since the last call;
+    // widgets pick the colors up on their next update
+    void update_alerts(const LayoutInputs& inputs);
+    // Updates the widgets that are due at `now_ms`
+    void update(uint64_t now_ms, const LayoutInputs& inputs, TextBatch& batch);
+
+private:
+    enum OpKind : uint8_t { OP_TEXT, OP_GRAPH, OP_BAR, OP_GAUGE, OP_HEATMAP };
+
+    struct DrawOp {
+        OpKind kind;
+        LayoutValue value;        // Graphed, bar or gauge value
+        int run;                  // TextBatch run holding the op's output
+        int label_run;            // Run for the label of a bar or gauge, or -1
+        uint32_t label_first, label_length; // Label text in `literals`
+        uint32_t columns;         // Heatmap cells per row
+        uint32_t rate_ms;
+        uint64_t next_update_ms;
+        uint32_t segment_first, segment_count; // Format segments of a text op
+        uint32_t history_first;   // GRAPH_SAMPLES floats in `history`
+        uint32_t history_head;    // Slot the next sample goes to
+        float max;                // Graph, bar or gauge range; 0 for a graph's largest sample
+        float x, y, width, height; // Row, placed by place()
+        float align_x;
+    };
+
+    // Literal text followed by an optional formatted value
+    struct FormatSegment {
+        uint32_t literal_first;
+        uint16_t literal_length;
+        LayoutValue value;
+        uint8_t decimals;
+    };
+
+    struct AlertRule {
+        bool below;       // Matches values below the threshold, else above it
+        float threshold;
+        uint32_t rgba;
+    };
+
+    bool compile_text(DrawOp& op, const std::string& format, const std::string& name);
+    bool compile_alert(const AlertSpec& alert);
+    // The alert color of `value` if it alerts, else the widget color
+    uint32_t color_of(LayoutValue value) const { return alert_color[value] ? alert_color[value] : rgba; }
+    void update_text(DrawOp& op, const LayoutInputs& inputs, TextBatch& batch);
+    void update_graph(DrawOp& op, const LayoutInputs& inputs, TextBatch& batch);
+    void update_bar(DrawOp& op, const LayoutInputs& inputs, TextBatch& batch);
+    void update_heatmap(DrawOp& op, const LayoutInputs& inputs, TextBatch& batch);
+
+    std::vector<DrawOp> ops;
+    std::vector<FormatSegment> segments;
+    std::string literals;
+    std::vector<float> history;
+    std::vector<uint32_t> history_colors; // Color of each graph sample, fixed when it is taken
+    std::vector<AlertRule> rules;
+    uint16_t rule_first[VALUE_COUNT] = {}, rule_count[VALUE_COUNT] = {}; // Each value's rules
+    float alert_value[VALUE_COUNT] = {};  // Value the current alert colors were evaluated for
+    uint32_t alert_color[VALUE_COUNT] = {}; // 0 when not alerting
+    std::vector<GlyphInstance> quads; // Scratch for shape output
+    uint32_t interval = 1000;
+    bool cores = false;
+    int core_count = 1; // Heatmap cells, fixed at compile so rows never reflow
+    uint32_t rgba = 0xFFFFFFFF;
+    float scale = 1.0f;
+};
+
+#endif // LAYOUT_HPP
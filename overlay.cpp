@@ -1,5 +1,4 @@
 #define _GNU_SOURCE
-#define STB_TRUETYPE_IMPLEMENTATION
 
 #include <GL/glew.h>
 #include <GL/glx.h>
@@ -12,10 +11,29 @@
 #include <memory>
 #include <sstream>
 #include <algorithm>
+#include <cstdlib>
 #include <cstring> // For strlen
+#include <cstddef> // For offsetof
+#include <cmath>
 
 #include "stats.hpp" // Assumes you have this file for get_cpu_usage()
-#include "stb_truetype.h"
+#include "hitch.hpp"
+#include "capture.hpp"
+#include "gpu_timer.hpp"
+#include "font_atlas.hpp"
+#include "text_batch.hpp"
+#include "layout.hpp"
+#include "bench.hpp"
+#include "gl_context.hpp"
+#include "gl_shadow.hpp"
+#include "context_map.hpp"
+#include "paths.hpp"
+#include "embedded_assets.hpp"
+
+#include <unistd.h>
+#include <atomic>
+#include <thread>
+#include <mutex>
 
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
@@ -23,22 +41,160 @@
 
 // --- A struct to hold our settings ---
 struct OverlaySettings {
-    enum Corner { TOP_LEFT, TOP_RIGHT };
-    Corner position = TOP_LEFT;
+    // Where the text sits; offset_x/offset_y are its distance from the anchored
+    // edges in pixels, or a shift right and down from the middle for CENTER
+    enum Anchor { TOP_LEFT, TOP_RIGHT, BOTTOM_LEFT, BOTTOM_RIGHT, CENTER };
+    Anchor position = TOP_LEFT;
+    float offset_x = 10.0f, offset_y = 10.0f;
     glm::vec3 color = glm::vec3(1.0f, 1.0f, 0.0f); // Default to yellow
+
+    // Hitch detector: a frame slower than hitch_threshold x the median is dumped (0 disables)
+    float hitch_threshold = 3.0f;
+    int hitch_max = 256;
+    std::string hitch_log; // Empty means /tmp/overlay_hitches_<pid>.bin
+
+    CaptureSettings capture;
+
+    // Render the overlay into its own texture only when it changes, then composite it with one quad
+    bool offscreen = true;
+
+    // Text size relative to the 16px default; the distance field atlas needs no re-bake for it
+    float text_scale = 1.0f;
+    std::string font; // TrueType file to use instead of the embedded DejaVu Sans
+
+    // Legibility over bright scenes: a rounded panel behind the widgets
+    // (background_alpha 0 disables it), and an outline and/or drop shadow
+    // around glyphs, in pixels, made by the shader from the distance field.
+    // Both effects stay within the field's margin, so they are capped at 2px.
+    float background_alpha = 0.0f;
+    std::string background_color = "#000000";
+    float background_padding = 6.0f, background_radius = 6.0f;
+    float text_outline = 0.0f, text_shadow = 0.0f;
+    std::string outline_color = "#000000", shadow_color = "#000000";
+
+    // widget<N> lines, see Layout; the default stats line if there are none
+    std::vector<WidgetSpec> widgets;
+    std::vector<AlertSpec> alerts; // alert_<value> lines
+
+    // How the application's GL state is protected while we draw:
+    // RESTORE queries it and puts it back, CONTEXT draws through our own GLX context,
+    // SHADOW puts it back from the copy tracked by our interposed state setters,
+    // AUTO times RESTORE and CONTEXT on the running driver and keeps the faster.
+    // SHADOW is opt-in only: setters the application resolves with dlsym bypass
+    // the interposer, so it has to be validated per title (OVERLAY_SHADOW_VERIFY).
+    enum StateMode { STATE_AUTO, STATE_RESTORE, STATE_CONTEXT, STATE_SHADOW };
+    StateMode state_mode = STATE_AUTO;
+};
+
+// Container objects (VAOs, FBOs) aren't shared between contexts, so every
+// context the overlay draws from gets its own set
+struct ContextObjects {
+    GLuint vao = 0;
+    GLuint composite_vao = 0;
+    GLuint fbo = 0;
+    // Where `vao`'s instance attributes point: which text stream buffer, and the offset in it
+    unsigned stream_generation = 0;
+    size_t stream_offset = 0;
+    GLuint glyph_vao = 0; // OVERLAY_BENCH=per_glyph only, reads GroupResources::glyph_vbo
+};
+
+// Buffers, textures and programs are seen by every context of a share group,
+// but not by other groups, so each group the overlay draws in gets its own set
+struct GroupResources {
+    AtlasTexture font_texture;
+    StreamBuffer text_stream;
+    size_t stream_offset = 0;     // Where the batch's instances are in text_stream
+    unsigned batch_revision = 0;  // TextBatch::revision() written there and to fbo_texture
+    GLuint shader_program = 0;
+    GLuint composite_program = 0;
+    GLuint composite_vbo = 0;
+    GLuint fbo_texture = 0;       // Offscreen target, sized to the overlay contents rather than the drawable
+    int fbo_width = 0, fbo_height = 0;  // Allocated texture size
+    GLuint glyph_vbo = 0;         // One glyph, rewritten per draw; OVERLAY_BENCH=per_glyph only
+    // Drawable size the programs' projection was uploaded for; the next draw
+    // on a drawable of another size uploads it again, inside the protected state
+    unsigned int projection_width = 0, projection_height = 0;
+};
+
+// Share groups the overlay can draw in at once
+static constexpr int MAX_SHARE_GROUPS = 8;
+
+// An application context the overlay has seen swap
+struct AppContext {
+    int group = -1;         // Its share group's slot in Overlay::groups; -1 if they were all taken
+    ContextObjects objects; // Created on the context's first overlay frame
+};
+
+// A drawable the overlay has drawn on. The application may swap several
+// (tool windows, a pbuffer...), each with its own size.
+struct DrawableState {
+    GLXDrawable drawable = None; // None if the slot is free
+    unsigned int width = 0, height = 0;
+    glm::mat4 projection;        // Y=0 at the top
+    std::chrono::steady_clock::time_point next_size_poll;
+    uint64_t last_swap = 0;      // Overlay::swap_count when it last swapped, to evict the stalest
 };
 
+// Drawables remembered at once; past that the stalest one is forgotten
+static constexpr int MAX_DRAWABLES = 8;
+// How often the hook checks whether a drawable changed size
+static constexpr std::chrono::milliseconds SIZE_POLL_INTERVAL(250);
+
+// Text size and the distance between text rows at text_scale 1, in pixels
+static constexpr float FONT_PIXEL_HEIGHT = 16.0f;
+static constexpr float LINE_HEIGHT = 20.0f;
+
 // --- Global state for our overlay ---
 struct Overlay {
     bool initialized = false;
-    GLuint vao = 0, vbo = 0;
-    GLuint font_texture = 0;
-    GLuint shader_program = 0;
-    stbtt_bakedchar cdata[96];
+    FontAtlas font;
+    TextBatch text_batch{FONT_PIXEL_HEIGHT, LINE_HEIGHT};
+
+    // The widgets, re-laid out only when their output changes
+    Layout layout;
+    LayoutInputs inputs; // Latest stats
+
+    // Drawables that swapped, and the one swapping this frame
+    DrawableState drawables[MAX_DRAWABLES];
+    DrawableState* drawable = nullptr;
+    uint64_t swap_count = 0;
+    bool layout_placed = false;
+    unsigned int placed_width = 0, placed_height = 0; // Drawable size the layout is placed for
+
+    // GL objects of each share group, made on the group's first overlay frame
+    GroupResources groups[MAX_SHARE_GROUPS];
+    // Group our own context shares and AUTO mode calibrates in; -1 until a context swaps
+    int home_group = -1;
+
+    // Objects for our dedicated context; the application's are in app_contexts
+    ContextObjects own_objects;
+    AppContext* app = nullptr;          // The application context swapping this frame
+    GroupResources* group = nullptr;    // Its share group's objects
+    ContextObjects* objects = nullptr;  // Set for the context currently drawing
+    const GLShadowState* shadow = nullptr;   // Set while the shadow path draws
+    OverlayContext own_context;
+    OverlaySettings::StateMode active_mode = OverlaySettings::STATE_RESTORE;
+    unsigned int own_viewport_width = 0, own_viewport_height = 0; // Last set on our own context
+
+    // AUTO mode's per-path timings, see render_calibrating; reset with each new home group
+    struct Calibration {
+        int frame = 0;
+        double total_us[2] = {0.0, 0.0};
+        int samples[2] = {0, 0};
+    } calibration;
     
     // Stats
     double fps = 0.0;
-    double cpu_usage = 0.0;
+    SystemSample sample;       // Latest collector values
+    SystemSampler sampler;     // Runs the collectors off the render thread
+    float driver_gpu_busy = -1.0f; // Last gpu_busy the driver reported, negative if none
+    FrameTiming timing;        // Averages over the last stats window
+    FrameTiming timing_accum;  // Running sums for the current window
+    HitchDetector hitches;
+    GpuTimer gpu_timer;
+    Capture capture;
+    bool prepared = false;       // CPU-side preparation succeeded
+    double atlas_build_ms = 0.0; // Font atlas load or bake, for the startup benchmark
 
     // Add settings to our state
     OverlaySettings settings;
@@ -46,8 +202,102 @@ struct Overlay {
 
 static std::unique_ptr<Overlay> overlay_state;
 
+// Kept outside the Overlay: contexts are destroyed on whatever thread the
+// application likes, and the callback must not race the swap thread for it
+static ContextMap<AppContext, 64> app_contexts;
+static std::atomic<GLXContext> timer_context{nullptr}; // GPU timer queries live there
+
+// Which share group each of Overlay::groups serves. Only the swap thread
+// claims and frees slots; the destroy callback only marks them lost.
+struct GroupSlot {
+    std::atomic<GLXContext> context{nullptr}; // First context seen in the group; nullptr if free
+    std::atomic<unsigned> share_group{0};     // 0 if untracked, and then `context` is the whole group
+    std::atomic<bool> lost{false};            // Set once no context holds the group's objects anymore
+};
+static GroupSlot group_slots[MAX_SHARE_GROUPS];
+
 // --- Shader code ---
+// Expands each glyph instance into a quad
 const char* vertex_shader_source = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec2 glyph_pos;   // Top-left corner
+    layout (location = 1) in vec2 glyph_size;
+    layout (location = 2) in vec4 glyph_uv;    // s0, t0, s1, t1
+    layout (location = 3) in vec4 glyph_color;
+    out vec2 TexCoords;
+    out vec4 GlyphColor;
+    out vec2 Local;        // Position in the quad, pixels
+    flat out int Solid;
+    flat out vec2 BoxSize;
+    flat out float Radius;
+    uniform mat4 projection;
+    void main() {
+        // Corner of the unit quad, from the vertex index of a 4-vertex strip
+        vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);
+        BoxSize = glyph_size * 0.125; // Size is in 1/8 px
+        Local = corner * BoxSize;
+        gl_Position = projection * vec4(glyph_pos + Local, 0.0, 1.0);
+        // Our projection has Y pointing down, so t0/t1 are swapped to keep glyphs upright
+        TexCoords = vec2(mix(glyph_uv.x, glyph_uv.z, corner.x), mix(glyph_uv.w, glyph_uv.y, corner.y));
+        GlyphColor = glyph_color;
+        Solid = glyph_uv.x > glyph_uv.z ? 1 : 0; // See solid_quad()
+        Radius = glyph_uv.y * 65535.0 * 0.125;
+    }
+)glsl";
+
+const char* fragment_shader_source = R"glsl(
+    #version 330 core
+    in vec2 TexCoords;
+    in vec4 GlyphColor;
+    in vec2 Local;
+    flat in int Solid;
+    flat in vec2 BoxSize;
+    flat in float Radius;
+    out vec4 color;
+    uniform sampler2D text;
+    uniform float dist_per_texel; // Field units per atlas texel
+    uniform float outline_px;     // 0 for no outline
+    uniform vec4 outline_color;
+    uniform vec2 shadow_px;       // Shadow offset, 0 for no shadow
+    uniform vec4 shadow_color;
+    void main() {
+        if (Solid != 0) {
+            // Rounded box: distance to the corner circles, antialiased over a pixel
+            vec2 q = abs(Local - BoxSize * 0.5) - (BoxSize * 0.5 - Radius);
+            float d = length(max(q, 0.0)) + min(max(q.x, q.y), 0.0) - Radius;
+            color = vec4(GlyphColor.rgb, GlyphColor.a * clamp(0.5 - d, 0.0, 1.0));
+            return;
+        }
+        // Signed distance field: 0.5 on the outline. Smoothing over one screen
+        // pixel's worth of distance keeps edges crisp at any scale.
+        float dist = texture(text, TexCoords).r;
+        float smoothing = max(fwidth(dist) * 0.75, 1e-4);
+        float coverage = smoothstep(0.5 - smoothing, 0.5 + smoothing, dist);
+        color = vec4(GlyphColor.rgb, GlyphColor.a * coverage);
+        if (outline_px <= 0.0 && shadow_px == vec2(0.0)) return;
+
+        // Outline and shadow come from the same field: the outline is a lower
+        // threshold, the shadow a second sample displaced by whole pixels.
+        // Layers are combined premultiplied, then the result unpremultiplied.
+        vec2 uv_dx = dFdx(TexCoords), uv_dy = dFdy(TexCoords);
+        float dist_per_px = length(uv_dx) * float(textureSize(text, 0).x) * dist_per_texel;
+        vec4 result = vec4(color.rgb * color.a, color.a);
+        if (outline_px > 0.0) {
+            float edge = 0.5 - outline_px * dist_per_px;
+            float a = outline_color.a * GlyphColor.a * smoothstep(edge - smoothing, edge + smoothing, dist);
+            result += vec4(outline_color.rgb * a, a) * (1.0 - result.a);
+        }
+        if (shadow_px != vec2(0.0)) {
+            float shadow_dist = texture(text, TexCoords - uv_dx * shadow_px.x - uv_dy * shadow_px.y).r;
+            float a = shadow_color.a * GlyphColor.a * smoothstep(0.5 - smoothing, 0.5 + smoothing, shadow_dist);
+            result += vec4(shadow_color.rgb * a, a) * (1.0 - result.a);
+        }
+        color = vec4(result.rgb / max(result.a, 1e-4), result.a);
+    }
+)glsl";
+
+// Draws the composite quad, whose vertices are x, y, u, v
+const char* composite_vertex_shader_source = R"glsl(
     #version 330 core
     layout (location = 0) in vec4 vertex; // x, y, u, v
     out vec2 TexCoords;
@@ -58,23 +308,39 @@ const char* vertex_shader_source = R"glsl(
     }
 )glsl";
 
-const char* fragment_shader_source = R"glsl(
+// Composites the offscreen overlay texture, which holds premultiplied alpha
+const char* composite_fragment_shader_source = R"glsl(
     #version 330 core
     in vec2 TexCoords;
     out vec4 color;
-    uniform sampler2D text;
-    uniform vec3 textColor;
+    uniform sampler2D overlay;
     void main() {
-        vec4 sampled = vec4(1.0, 1.0, 1.0, texture(text, TexCoords).r);
-        color = vec4(textColor, 1.0) * sampled;
+        color = texture(overlay, TexCoords);
     }
 )glsl";
 
+// A numeric config value, or `fallback` with a complaint if it doesn't parse.
+// The config is read on the preparation thread, where an exception from
+// std::stof and friends would terminate the game.
+static float config_float(const std::string& text, const std::string& key, float fallback) {
+    const char* begin = text.c_str();
+    char* end = nullptr;
+    float value = std::strtof(begin, &end);
+    if (end == begin || *end != '\0' || !std::isfinite(value)) {
+        std::cerr << "Overlay Error: " << key << ": expected a number, got '" << text << "'" << std::endl;
+        return fallback;
+    }
+    return value;
+}
+
 // --- Simple function to parse our config.ini file ---
-void parse_config() {
-    std::ifstream config_file("config.ini");
+// The file is optional: every setting has a built-in default
+void parse_config(OverlaySettings& settings) {
+    std::string path = config_path();
+    std::ifstream config_file;
+    if (!path.empty()) config_file.open(path);
     if (!config_file) {
-        std::cout << "Overlay: config.ini not found. Using default settings." << std::endl;
+        std::cout << "Overlay: No config at " << (path.empty() ? "(no $HOME)" : path) << ". Using default settings." << std::endl;
         return;
     }
     std::string line;
@@ -88,27 +354,255 @@ void parse_config() {
             value.erase(value.find_last_not_of(" \t\n\r") + 1);
 
             if (key == "position") {
-                if (value == "top_right") overlay_state->settings.position = OverlaySettings::TOP_RIGHT;
-                else overlay_state->settings.position = OverlaySettings::TOP_LEFT;
+                if (value == "top_right") settings.position = OverlaySettings::TOP_RIGHT;
+                else if (value == "bottom_left") settings.position = OverlaySettings::BOTTOM_LEFT;
+                else if (value == "bottom_right") settings.position = OverlaySettings::BOTTOM_RIGHT;
+                else if (value == "center") settings.position = OverlaySettings::CENTER;
+                else settings.position = OverlaySettings::TOP_LEFT;
+            } else if (key == "offset_x") {
+                settings.offset_x = config_float(value, key, settings.offset_x);
+            } else if (key == "offset_y") {
+                settings.offset_y = config_float(value, key, settings.offset_y);
             } else if (key == "color_r") {
-                overlay_state->settings.color.r = std::stof(value);
+                settings.color.r = config_float(value, key, settings.color.r);
             } else if (key == "color_g") {
-                overlay_state->settings.color.g = std::stof(value);
+                settings.color.g = config_float(value, key, settings.color.g);
             } else if (key == "color_b") {
-                overlay_state->settings.color.b = std::stof(value);
+                settings.color.b = config_float(value, key, settings.color.b);
+            } else if (key == "hitch_threshold") {
+                settings.hitch_threshold = config_float(value, key, settings.hitch_threshold);
+            } else if (key == "hitch_max") {
+                settings.hitch_max = (int)std::min(std::max(config_float(value, key, settings.hitch_max), 1.0f), (float)HitchDetector::MAX_HITCHES);
+            } else if (key == "hitch_log") {
+                settings.hitch_log = value;
+            } else if (key == "capture_key") {
+                settings.capture.key = value;
+            } else if (key == "capture_duration") {
+                settings.capture.duration_s = config_float(value, key, settings.capture.duration_s);
+            } else if (key == "capture_delay") {
+                settings.capture.delay_s = config_float(value, key, settings.capture.delay_s);
+            } else if (key == "capture_dir") {
+                settings.capture.dir = value;
+            } else if (key == "offscreen") {
+                settings.offscreen = value == "1" || value == "true";
+            } else if (key == "state_mode") {
+                if (value == "restore") settings.state_mode = OverlaySettings::STATE_RESTORE;
+                else if (value == "context") settings.state_mode = OverlaySettings::STATE_CONTEXT;
+                else if (value == "shadow") settings.state_mode = OverlaySettings::STATE_SHADOW;
+                else settings.state_mode = OverlaySettings::STATE_AUTO;
+            } else if (key == "text_scale") {
+                settings.text_scale = std::max(0.25f, config_float(value, key, settings.text_scale));
+            } else if (key.compare(0, 6, "widget") == 0 && key.size() > 6 &&
+                       key.find_first_not_of("0123456789", 6) == std::string::npos) {
+                float index = config_float(key.substr(6), key, -1.0f);
+                if (index >= 0.0f && index <= 1e6f) {
+                    settings.widgets.push_back(WidgetSpec{(int)index, value});
+                } else {
+                    std::cerr << "Overlay Error: " << key << ": widget index out of range" << std::endl;
+                }
+            } else if (key.compare(0, 6, "alert_") == 0) {
+                settings.alerts.push_back(AlertSpec{key.substr(6), value});
+            } else if (key == "background_alpha") {
+                settings.background_alpha = std::min(std::max(config_float(value, key, settings.background_alpha), 0.0f), 1.0f);
+            } else if (key == "background_color") {
+                settings.background_color = value;
+            } else if (key == "background_padding") {
+                settings.background_padding = std::max(0.0f, config_float(value, key, settings.background_padding));
+            } else if (key == "background_radius") {
+                settings.background_radius = std::max(0.0f, config_float(value, key, settings.background_radius));
+            } else if (key == "text_outline") {
+                settings.text_outline = std::min(std::max(config_float(value, key, settings.text_outline), 0.0f), 2.0f);
+            } else if (key == "outline_color") {
+                settings.outline_color = value;
+            } else if (key == "text_shadow") {
+                settings.text_shadow = std::min(std::max(config_float(value, key, settings.text_shadow), 0.0f), 2.0f);
+            } else if (key == "shadow_color") {
+                settings.shadow_color = value;
+            } else if (key == "font") {
+                settings.font = expand_home(value);
+            } else if (key == "capture_trace") {
+                settings.capture.trace = value == "1" || value == "true";
             }
         }
     }
-    std::cout << "Overlay: Loaded settings from config.ini" << std::endl;
+    std::cout << "Overlay: Loaded settings from " << path << std::endl;
 }
 
 
-// ====================================================================================
-// ============================= START OF THE FIX =====================================
-// ====================================================================================
+// --- Point a VAO's per-instance attributes at glyph instances starting at `base` in `buffer` ---
+static void point_instance_attributes(GLuint vao, GLuint buffer, size_t base) {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, buffer);
+    const GLsizei stride = sizeof(GlyphInstance);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, stride, (void*)(base + offsetof(GlyphInstance, x)));
+    glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_FALSE, stride, (void*)(base + offsetof(GlyphInstance, w)));
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_SHORT, GL_TRUE, stride, (void*)(base + offsetof(GlyphInstance, s0)));
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE, stride, (void*)(base + offsetof(GlyphInstance, rgba)));
+    for (GLuint attrib = 0; attrib < 4; ++attrib) {
+        glEnableVertexAttribArray(attrib);
+        glVertexAttribDivisor(attrib, 1);
+    }
+}
 
-// --- Helper function to draw text (CORRECTED) ---
-void render_text(const std::string& text, float x, float y, float scale) {
+// --- Point a context's text VAO at the glyph instances in the stream buffer ---
+static void point_text_vao(ContextObjects& objects) {
+    GroupResources& g = *overlay_state->group;
+    point_instance_attributes(objects.vao, g.text_stream.buffer(), g.stream_offset);
+    objects.stream_generation = g.text_stream.generation();
+    objects.stream_offset = g.stream_offset;
+}
+
+// --- OVERLAY_BENCH=per_glyph: a one-glyph buffer for the group, and a VAO reading it ---
+static void create_per_glyph_objects(ContextObjects& objects) {
+    GroupResources& g = *overlay_state->group;
+    if (!g.glyph_vbo) {
+        glGenBuffers(1, &g.glyph_vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, g.glyph_vbo);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(GlyphInstance), NULL, GL_STREAM_DRAW);
+    }
+    glGenVertexArrays(1, &objects.glyph_vao);
+    point_instance_attributes(objects.glyph_vao, g.glyph_vbo, 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// --- Draw the cached text geometry with the text program ---
+static void draw_text_batch() {
+    // Each update lands at a new offset (and growing replaces the buffer);
+    // every context's VAO follows lazily, only on frames where that happened
+    ContextObjects& objects = *overlay_state->objects;
+    GroupResources& g = *overlay_state->group;
+    if (objects.stream_generation != g.text_stream.generation() || objects.stream_offset != g.stream_offset) {
+        point_text_vao(objects);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+    glUseProgram(g.shader_program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, g.font_texture.tex);
+    if (bench_mode_is("per_glyph")) {
+        if (!objects.glyph_vao) create_per_glyph_objects(objects);
+        overlay_state->text_batch.draw_per_glyph(objects.glyph_vao, g.glyph_vbo);
+    } else {
+        overlay_state->text_batch.draw(objects.vao);
+    }
+}
+
+// --- Re-render the overlay contents into the offscreen texture ---
+static void redraw_offscreen() {
+    Overlay& o = *overlay_state;
+    GroupResources& g = *o.group;
+    TextBatch& batch = o.text_batch;
+
+    // The screen rect the texture covers: the glyph bounds, snapped out to
+    // whole pixels with a small margin
+    float panel_x0 = std::floor(batch.min_x) - 2.0f;
+    float panel_y0 = std::floor(batch.min_y) - 2.0f;
+    float panel_x1 = std::ceil(batch.max_x) + 2.0f;
+    float panel_y1 = std::ceil(batch.max_y) + 2.0f;
+    int w = (int)(panel_x1 - panel_x0);
+    int h = (int)(panel_y1 - panel_y0);
+
+    // Grow in 64px steps so small text changes don't reallocate the texture
+    if (w > g.fbo_width || h > g.fbo_height) {
+        g.fbo_width = std::max(g.fbo_width, (w + 63) / 64 * 64);
+        g.fbo_height = std::max(g.fbo_height, (h + 63) / 64 * 64);
+        // Unit 0 is the only binding the render paths put back
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, g.fbo_texture);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, g.fbo_width, g.fbo_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+
+    // Only this path touches the framebuffer binding and viewport, so they're
+    // saved here rather than every frame. The shadow path already has them.
+    GLint last_fbo = 0, last_viewport[4] = {0, 0, 0, 0};
+    GLboolean last_scissor_test = GL_FALSE;
+    if (!o.shadow) {
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &last_fbo);
+        glGetIntegerv(GL_VIEWPORT, last_viewport);
+        last_scissor_test = glIsEnabled(GL_SCISSOR_TEST);
+    }
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, o.objects->fbo);
+    glViewport(0, 0, w, h);
+    glDisable(GL_SCISSOR_TEST);
+    // Unlike glClear, this leaves the application's clear color alone
+    const GLfloat transparent[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    glClearBufferfv(GL_COLOR, 0, transparent);
+
+    // Same orientation as the screen projection, restricted to the panel
+    glm::mat4 projection = glm::ortho(panel_x0, panel_x1, panel_y1, panel_y0);
+    glUseProgram(g.shader_program);
+    glUniformMatrix4fv(glGetUniformLocation(g.shader_program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    // Accumulate premultiplied color, with coverage in alpha
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+    draw_text_batch();
+    glUniformMatrix4fv(glGetUniformLocation(g.shader_program, "projection"), 1, GL_FALSE, glm::value_ptr(o.drawable->projection));
+
+    if (!o.shadow) {
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, last_fbo);
+        glViewport(last_viewport[0], last_viewport[1], last_viewport[2], last_viewport[3]);
+        if (last_scissor_test) glEnable(GL_SCISSOR_TEST);
+    }
+
+    // The texture's top row is the panel's top edge; only the used part is sampled
+    float u1 = (float)w / g.fbo_width, v1 = (float)h / g.fbo_height;
+    const float quad[] = {
+        panel_x0, panel_y1,   0.0f, 0.0f,
+        panel_x0, panel_y0,   0.0f, v1,
+        panel_x1, panel_y0,   u1,   v1,
+
+        panel_x0, panel_y1,   0.0f, 0.0f,
+        panel_x1, panel_y0,   u1,   v1,
+        panel_x1, panel_y1,   u1,   0.0f
+    };
+    glBindBuffer(GL_ARRAY_BUFFER, g.composite_vbo);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(quad), quad);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// --- Draw the overlay: cached geometry, one draw call ---
+// Expects depth test and face culling off and blending on.
+static void draw_overlay() {
+    Overlay& o = *overlay_state;
+    GroupResources& g = *o.group;
+    o.text_batch.update(o.font);
+    // Every texture the overlay binds goes on unit 0, the only one the render
+    // paths put back; the atlas upload below binds one too
+    glActiveTexture(GL_TEXTURE0);
+    // Characters seen for the first time were just added to the atlas
+    o.font.flush(g.font_texture);
+    // The batch changed since this group last drew it, here or in another group
+    bool changed = g.batch_revision != o.text_batch.revision();
+    if (changed) {
+        g.stream_offset = o.text_batch.write(g.text_stream);
+        g.batch_revision = o.text_batch.revision();
+    }
+    const DrawableState& d = *o.drawable;
+    if (g.projection_width != d.width || g.projection_height != d.height) {
+        for (GLuint program : { g.shader_program, g.composite_program }) {
+            glUseProgram(program);
+            glUniformMatrix4fv(glGetUniformLocation(program, "projection"), 1, GL_FALSE, glm::value_ptr(d.projection));
+        }
+        g.projection_width = d.width;
+        g.projection_height = d.height;
+    }
+    if (o.settings.offscreen) {
+        if (changed) redraw_offscreen();
+        // Every frame: one textured quad, however complex the overlay is
+        glUseProgram(g.composite_program);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, g.fbo_texture);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+        glBindVertexArray(o.objects->composite_vao);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glBindVertexArray(0);
+    } else {
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+        draw_text_batch();
+    }
+}
+
+// --- Helper function to draw the overlay inside the application's context ---
+void render_overlay() {
     // Save state that the host application might have set
     GLboolean last_cull_face = glIsEnabled(GL_CULL_FACE);
     GLboolean last_depth_test = glIsEnabled(GL_DEPTH_TEST);
@@ -118,94 +612,498 @@ void render_text(const std::string& text, float x, float y, float scale) {
     glDisable(GL_DEPTH_TEST);
 
     glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    glBindVertexArray(overlay_state->vao);
-    glBindBuffer(GL_ARRAY_BUFFER, overlay_state->vbo);
-
-    for (char c : text) {
-        if (c >= 32 && c < 128) {
-            stbtt_aligned_quad q;
-            stbtt_GetBakedQuad(overlay_state->cdata, 512, 512, c - 32, &x, &y, &q, 1);
-            
-            // THE FIX: Your projection matrix has an inverted Y-axis.
-            // To compensate, we must map the texture upside-down onto the quad.
-            // We do this by swapping the t0 and t1 texture coordinates.
-            //
-            // The top of the quad (q.y0) gets the BOTTOM texture coord (q.t1).
-            // The bottom of the quad (q.y1) gets the TOP texture coord (q.t0).
-            float vertices[] = {
-                // Pos(x,y)   Tex(u,v) - NOTE THE t0/t1 SWAP
-                q.x0, q.y1,   q.s0, q.t0, // Bottom-left pos gets Top-left tex
-                q.x0, q.y0,   q.s0, q.t1, // Top-left pos gets Bottom-left tex
-                q.x1, q.y0,   q.s1, q.t1, // Top-right pos gets Bottom-right tex
-
-                q.x0, q.y1,   q.s0, q.t0, // Bottom-left pos gets Top-left tex
-                q.x1, q.y0,   q.s1, q.t1, // Top-right pos gets Bottom-right tex
-                q.x1, q.y1,   q.s1, q.t0  // Bottom-right pos gets Top-right tex
-            };
-            
-            glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(vertices), vertices);
-            glDrawArrays(GL_TRIANGLES, 0, 6);
-        }
-    }
-    glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    
+    draw_overlay();
+
     // Restore the original state
     glDisable(GL_BLEND);
     if (last_cull_face) glEnable(GL_CULL_FACE);
     if (last_depth_test) glEnable(GL_DEPTH_TEST);
 }
 
-// ====================================================================================
-// ============================== END OF THE FIX ======================================
-// ====================================================================================
+static void create_group_resources(GroupResources& g);
 
+// --- Create the per-context container objects around the shared buffers and textures ---
+static void create_context_objects(ContextObjects& objects) {
+    Overlay& o = *overlay_state;
+    GroupResources& g = *o.group;
+    glGenVertexArrays(1, &objects.vao);
+    point_text_vao(objects);
 
-// --- Initialization function ---
-void initialize_overlay(int viewport_width, int viewport_height) {
-    overlay_state = std::make_unique<Overlay>();
-    parse_config();
-    if (glewInit() != GLEW_OK) { std::cerr << "Overlay Error: Failed to initialize GLEW" << std::endl; return; }
-    std::ifstream font_file("DejaVuSans.ttf", std::ios::binary);
-    if (!font_file) { std::cerr << "Overlay Error: Could not open font file." << std::endl; return; }
-    std::vector<unsigned char> font_buffer(std::istreambuf_iterator<char>(font_file), {});
-    std::vector<unsigned char> bitmap(512 * 512);
-    stbtt_BakeFontBitmap(font_buffer.data(), 0, 16.0f, bitmap.data(), 512, 512, 32, 96, overlay_state->cdata);
-    glGenTextures(1, &overlay_state->font_texture);
-    glBindTexture(GL_TEXTURE_2D, overlay_state->font_texture);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RED, 512, 512, 0, GL_RED, GL_UNSIGNED_BYTE, bitmap.data());
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenVertexArrays(1, &objects.composite_vao);
+    glBindVertexArray(objects.composite_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, g.composite_vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+
+    if (o.settings.offscreen) {
+        GLint last_fbo;
+        glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &last_fbo);
+        glGenFramebuffers(1, &objects.fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, objects.fbo);
+        glFramebufferTexture2D(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, g.fbo_texture, 0);
+        if (glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+            std::cerr << "Overlay Error: Offscreen framebuffer incomplete, drawing directly" << std::endl;
+            o.settings.offscreen = false;
+        }
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, last_fbo);
+    }
+}
+
+// --- Objects of the drawing context, and of its share group, created on first use ---
+// Runs inside the render paths, so whatever creating them binds is put back
+// with the rest of the state
+static ContextObjects* context_objects(ContextObjects& objects) {
+    if (!overlay_state->group->shader_program) create_group_resources(*overlay_state->group);
+    if (!objects.vao) create_context_objects(objects);
+    return &objects;
+}
+
+// --- Restore path: query the application's state, draw, and put it back ---
+static void render_with_restore() {
+    // --- Save the application's current GL state ---
+    // This is crucial for not breaking the game's rendering pipeline
+    GLint last_program, last_active_texture, last_texture, last_vao, last_array_buffer;
+    GLint last_blend_src_rgb, last_blend_dst_rgb, last_blend_src_alpha, last_blend_dst_alpha;
+    glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
+    // The overlay only binds textures on unit 0, so that is the binding to keep
+    glGetIntegerv(GL_ACTIVE_TEXTURE, &last_active_texture);
+    if (last_active_texture != GL_TEXTURE0) glActiveTexture(GL_TEXTURE0);
+    glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
+    glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vao);
+    glGetIntegerv(GL_ARRAY_BUFFER_BINDING, &last_array_buffer);
+    glGetIntegerv(GL_BLEND_SRC_RGB, &last_blend_src_rgb);
+    glGetIntegerv(GL_BLEND_DST_RGB, &last_blend_dst_rgb);
+    glGetIntegerv(GL_BLEND_SRC_ALPHA, &last_blend_src_alpha);
+    glGetIntegerv(GL_BLEND_DST_ALPHA, &last_blend_dst_alpha);
+    GLboolean last_blend_enabled = glIsEnabled(GL_BLEND);
+
+    overlay_state->objects = context_objects(overlay_state->app->objects);
+    render_overlay();
+
+    // --- Restore the application's original GL state ---
+    glUseProgram(last_program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, last_texture);
+    if (last_active_texture != GL_TEXTURE0) glActiveTexture(last_active_texture);
+    glBindVertexArray(last_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, last_array_buffer);
+    if (last_blend_enabled) glEnable(GL_BLEND); else glDisable(GL_BLEND);
+    glBlendFuncSeparate(last_blend_src_rgb, last_blend_dst_rgb, last_blend_src_alpha, last_blend_dst_alpha);
+}
+
+// --- Shadow path: draw, then put the application's state back from the tracked copy ---
+static void render_with_shadow() {
+    Overlay& o = *overlay_state;
+    gl_shadow_verify();
+    const GLShadowState* shadow = gl_shadow_sync();
+    if (!shadow) {
+        render_with_restore();
+        return;
+    }
+    o.objects = context_objects(o.app->objects);
+    o.shadow = shadow;
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    draw_overlay();
+    o.shadow = nullptr;
+    gl_shadow_restore(*shadow);
+}
+
+// --- Context path: draw through our own context, whose state only we ever touch ---
+static void render_with_context(GLXDrawable drawable) {
+    Overlay& o = *overlay_state;
+    if (!o.own_context.begin(drawable)) {
+        render_with_restore();
+        return;
+    }
+    o.objects = context_objects(o.own_objects);
+    const DrawableState& d = *o.drawable;
+    if (o.own_viewport_width != d.width || o.own_viewport_height != d.height) {
+        glViewport(0, 0, d.width, d.height);
+        o.own_viewport_width = d.width;
+        o.own_viewport_height = d.height;
+    }
+    draw_overlay();
+    o.own_context.end();
+}
+
+// --- Create our context and give it the fixed state the overlay needs ---
+static bool setup_own_context(Display* dpy, GLXDrawable drawable) {
+    Overlay& o = *overlay_state;
+    if (!o.own_context.create(dpy, glXGetCurrentContext())) return false;
+    if (!o.own_context.begin(drawable)) {
+        o.own_context.destroy();
+        return false;
+    }
+    glDisable(GL_CULL_FACE);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    o.own_context.end();
+    o.own_viewport_width = o.own_viewport_height = 0; // A new context's viewport is set on its first draw
+    return true;
+}
+
+// --- AUTO mode: alternate between the paths in blocks, then keep the cheaper ---
+static constexpr int CALIBRATION_BLOCK = 60;   // Frames per block
+static constexpr int CALIBRATION_WARMUP = 10;  // Frames ignored at the start of each block
+static constexpr int CALIBRATION_BLOCKS = 6;   // Blocks in total, half per path
+
+static void render_calibrating(GLXDrawable drawable) {
+    static const OverlaySettings::StateMode paths[] = { OverlaySettings::STATE_RESTORE, OverlaySettings::STATE_CONTEXT };
+    static const char* path_names[] = { "restore", "context" };
+    Overlay& o = *overlay_state;
+    int& frame = o.calibration.frame;
+    double* total_us = o.calibration.total_us;
+    int* samples = o.calibration.samples;
+
+    int path = (frame / CALIBRATION_BLOCK) % 2;
+    // Without our own context every block goes to the restore path
+    if (!o.own_context.valid()) path = 0;
+    auto start = std::chrono::steady_clock::now();
+    if (path == 0) render_with_restore();
+    else render_with_context(drawable);
+    if (frame % CALIBRATION_BLOCK >= CALIBRATION_WARMUP) {
+        total_us[path] += std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+        samples[path]++;
+    }
+
+    if (++frame == CALIBRATION_BLOCK * CALIBRATION_BLOCKS) {
+        int best = 0;
+        std::cout << "Overlay:";
+        for (int i = 0; i < 2; ++i) {
+            if (samples[i] == 0) continue;
+            std::cout << " " << path_names[i] << " path " << total_us[i] / samples[i] << " us,";
+            if (total_us[i] / samples[i] < total_us[best] / samples[best]) best = i;
+        }
+        std::cout << " on " << (const char*)glGetString(GL_RENDERER)
+                  << "; using " << path_names[best] << " path" << std::endl;
+        o.active_mode = paths[best];
+        if (best != 1) o.own_context.destroy();
+    }
+}
+
+// --- Anchor point and alignment of the text for the configured position ---
+// Y grows downwards because of our projection matrix
+static void anchor_point(const OverlaySettings& settings, unsigned int viewport_width, unsigned int viewport_height,
+                         float& x, float& y, float& align_x, float& align_y) {
+    switch (settings.position) {
+        case OverlaySettings::TOP_LEFT:     align_x = 0.0f; align_y = 0.0f; break;
+        case OverlaySettings::TOP_RIGHT:    align_x = 1.0f; align_y = 0.0f; break;
+        case OverlaySettings::BOTTOM_LEFT:  align_x = 0.0f; align_y = 1.0f; break;
+        case OverlaySettings::BOTTOM_RIGHT: align_x = 1.0f; align_y = 1.0f; break;
+        case OverlaySettings::CENTER:
+            x = viewport_width * 0.5f + settings.offset_x;
+            y = viewport_height * 0.5f + settings.offset_y;
+            align_x = align_y = 0.5f;
+            return;
+    }
+    x = align_x == 0.0f ? settings.offset_x : viewport_width - settings.offset_x;
+    y = align_y == 0.0f ? settings.offset_y : viewport_height - settings.offset_y;
+}
+
+// --- Refresh the values widgets show; called on the layout's update interval ---
+void update_stats_values(double elapsed_s, int frame_count) {
+    Overlay& o = *overlay_state;
+    o.fps = frame_count / elapsed_s;
+    // Keeps the previous values until the sampler has new ones
+    SystemSample sampled;
+    bool fresh = o.sampler.latest(sampled, o.layout.wants_cores() ? &o.inputs.core_usage : nullptr);
+    if (fresh) {
+        o.sample.cpu_usage = sampled.cpu_usage;
+        o.sample.mem_usage = sampled.mem_usage;
+    }
+    o.timing.app_cpu_ms = o.timing_accum.app_cpu_ms / frame_count;
+    o.timing.present_wait_ms = o.timing_accum.present_wait_ms / frame_count;
+    o.timing_accum = FrameTiming{};
+
+    float* values = o.inputs.values;
+    values[VALUE_FPS] = (float)o.fps;
+    values[VALUE_FRAME_MS] = (float)(elapsed_s * 1000.0 / frame_count);
+    values[VALUE_APP_MS] = (float)o.timing.app_cpu_ms;
+    values[VALUE_WAIT_MS] = (float)o.timing.present_wait_ms;
+    values[VALUE_GPU_MS] = o.gpu_timer.last_gpu_ms();
+
+    // Without a driver that reports it, GPU load is estimated as the share of
+    // the frame interval the GPU spent on the frame
+    if (fresh) o.driver_gpu_busy = sampled.gpu_busy;
+    double gpu_busy = o.driver_gpu_busy;
+    if (gpu_busy < 0.0) gpu_busy = values[VALUE_FRAME_MS] > 0.0f ? std::min(100.0f, 100.0f * values[VALUE_GPU_MS] / values[VALUE_FRAME_MS]) : 0.0f;
+    o.sample.gpu_busy = (float)gpu_busy;
+
+    for (int id = 0; id < METRIC_COUNT; ++id) {
+        values[VALUE_METRIC_FIRST + id] = metric_value(o.sample, (MetricId)id);
+    }
+    o.layout.update_alerts(o.inputs);
+}
+
+// --- Called whenever a drawable is first seen or changes size ---
+static void resize_drawable(DrawableState& d, unsigned int width, unsigned int height) {
+    d.width = width;
+    d.height = height;
+    // Use an orthographic projection where Y=0 is the TOP of the screen.
+    // This is the root cause of the flip, which we fix when laying out glyph quads.
+    // Binding our programs here would leak into the application's state, so
+    // each group's next draw on this drawable uploads it instead.
+    d.projection = glm::ortho(0.0f, (float)width, (float)height, 0.0f);
+}
+
+// --- The entry for `drawable`, claiming a free or the stalest slot if it is new ---
+static DrawableState& find_drawable(Display* dpy, GLXDrawable drawable, std::chrono::steady_clock::time_point now) {
+    Overlay& o = *overlay_state;
+    o.swap_count++;
+    DrawableState* slot = &o.drawables[0];
+    for (DrawableState& d : o.drawables) {
+        if (d.drawable == drawable) {
+            d.last_swap = o.swap_count;
+            return d;
+        }
+        if (d.last_swap < slot->last_swap) slot = &d;
+    }
+    *slot = DrawableState{};
+    slot->drawable = drawable;
+    slot->last_swap = o.swap_count;
+    unsigned int width = 0, height = 0;
+    glXQueryDrawable(dpy, drawable, GLX_WIDTH, &width);
+    glXQueryDrawable(dpy, drawable, GLX_HEIGHT, &height);
+    if (!width || !height) {
+        // Older GLX implementations don't report the size of plain windows
+        Window root; int x, y; unsigned int border, depth;
+        XGetGeometry(dpy, drawable, &root, &x, &y, &width, &height, &border, &depth);
+    }
+    resize_drawable(*slot, width, height);
+    slot->next_size_poll = now + SIZE_POLL_INTERVAL;
+    return *slot;
+}
+
+// --- Place the widgets for the drawable about to be drawn, if its size differs ---
+static void place_layout(const DrawableState& d) {
+    Overlay& o = *overlay_state;
+    if (o.layout_placed && o.placed_width == d.width && o.placed_height == d.height) return;
+    o.layout_placed = true;
+    o.placed_width = d.width;
+    o.placed_height = d.height;
+    // Corner-anchored widgets move with the drawable size, which marks the batch dirty
+    float x, y, align_x, align_y;
+    anchor_point(o.settings, d.width, d.height, x, y, align_x, align_y);
+    o.layout.place(x, y, align_x, align_y, o.settings.text_scale, LINE_HEIGHT);
+}
+
+// --- GlyphInstance::rgba as a shader color ---
+static glm::vec4 unpack_rgba(uint32_t rgba) {
+    return glm::vec4((rgba & 0xFF) / 255.0f, (rgba >> 8 & 0xFF) / 255.0f, (rgba >> 16 & 0xFF) / 255.0f, (rgba >> 24) / 255.0f);
+}
+
+// A config color, or `fallback` with a complaint if it doesn't parse
+static uint32_t config_rgba(const std::string& text, const char* key, const char* fallback) {
+    uint32_t rgba = parse_rgba(text);
+    if (rgba) return rgba;
+    std::cerr << "Overlay Error: " << key << ": expected #rrggbb or #rrggbbaa, got '" << text << "'" << std::endl;
+    return parse_rgba(fallback);
+}
+
+// --- The panel behind the widgets; part of the glyph batch, so it costs no draw call ---
+static void configure_background(Overlay& o) {
+    const OverlaySettings& s = o.settings;
+    uint32_t rgba = config_rgba(s.background_color, "background_color", "#000000") & 0x00FFFFFF;
+    rgba |= (uint32_t)std::lround(s.background_alpha * 255.0f) << 24;
+    o.text_batch.set_background(rgba, s.background_padding * s.text_scale, s.background_radius * s.text_scale);
+}
+
+// --- Outline and shadow parameters; uniforms are program state, so once is enough ---
+static void set_effect_uniforms(GLuint program, const OverlaySettings& s) {
+    glUseProgram(program);
+    glUniform1f(glGetUniformLocation(program, "dist_per_texel"), (float)FontAtlas::ON_EDGE / FontAtlas::PADDING / 255.0f);
+    glUniform1f(glGetUniformLocation(program, "outline_px"), s.text_outline);
+    glUniform4fv(glGetUniformLocation(program, "outline_color"), 1, glm::value_ptr(unpack_rgba(config_rgba(s.outline_color, "outline_color", "#000000"))));
+    glUniform2f(glGetUniformLocation(program, "shadow_px"), s.text_shadow, s.text_shadow);
+    glUniform4fv(glGetUniformLocation(program, "shadow_color"), 1, glm::value_ptr(unpack_rgba(config_rgba(s.shadow_color, "shadow_color", "#000000"))));
+}
+
+static GLuint link_program(const char* vertex_source, const char* fragment_source) {
     GLuint vs = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vs, 1, &vertex_shader_source, NULL);
+    glShaderSource(vs, 1, &vertex_source, NULL);
     glCompileShader(vs);
     GLuint fs = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fs, 1, &fragment_shader_source, NULL);
+    glShaderSource(fs, 1, &fragment_source, NULL);
     glCompileShader(fs);
-    overlay_state->shader_program = glCreateProgram();
-    glAttachShader(overlay_state->shader_program, vs);
-    glAttachShader(overlay_state->shader_program, fs);
-    glLinkProgram(overlay_state->shader_program);
+    GLuint program = glCreateProgram();
+    glAttachShader(program, vs);
+    glAttachShader(program, fs);
+    glLinkProgram(program);
     glDeleteShader(vs);
     glDeleteShader(fs);
-    glGenVertexArrays(1, &overlay_state->vao);
-    glGenBuffers(1, &overlay_state->vbo);
-    glBindVertexArray(overlay_state->vao);
-    glBindBuffer(GL_ARRAY_BUFFER, overlay_state->vbo);
+    return program;
+}
+
+// --- Buffers, textures and programs for a share group, on its first overlay frame ---
+static void create_group_resources(GroupResources& g) {
+    Overlay& o = *overlay_state;
+    // The texture allocations below would read from an application pixel buffer
+    GLint last_unpack_buffer;
+    glGetIntegerv(GL_PIXEL_UNPACK_BUFFER_BINDING, &last_unpack_buffer);
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    glActiveTexture(GL_TEXTURE0);
+
+    o.font.upload(g.font_texture);
+    g.shader_program = link_program(vertex_shader_source, fragment_shader_source);
+    set_effect_uniforms(g.shader_program, o.settings);
+    g.composite_program = link_program(composite_vertex_shader_source, composite_fragment_shader_source);
+    // Shared with our own context too; VAOs and FBOs are per context
+    g.text_stream.init(TextBatch::INITIAL_BYTES);
+
+    // Offscreen target and the quad that composites it
+    glGenBuffers(1, &g.composite_vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, g.composite_vbo);
     glBufferData(GL_ARRAY_BUFFER, sizeof(float) * 6 * 4, NULL, GL_DYNAMIC_DRAW);
-    glEnableVertexAttribArray(0);
-    glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, 4 * sizeof(float), 0);
     glBindBuffer(GL_ARRAY_BUFFER, 0);
-    glBindVertexArray(0);
-    
-    // Use an orthographic projection where Y=0 is the TOP of the screen.
-    // This is the root cause of the flip, which we fix in render_text().
-    glm::mat4 projection = glm::ortho(0.0f, (float)viewport_width, (float)viewport_height, 0.0f);
-    
-    glUseProgram(overlay_state->shader_program);
-    glUniformMatrix4fv(glGetUniformLocation(overlay_state->shader_program, "projection"), 1, GL_FALSE, glm::value_ptr(projection));
+    if (o.settings.offscreen) {
+        glGenTextures(1, &g.fbo_texture);
+        glBindTexture(GL_TEXTURE_2D, g.fbo_texture);
+        g.fbo_width = g.fbo_height = 64;
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 64, 64, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, last_unpack_buffer);
+}
+
+// --- Asynchronous preparation ---
+// Everything that doesn't need GL (config, the font atlas) is done
+// on a background thread started when the library loads, so the game's first
+// frames are never held up. The swap hook leaves frames untouched until the
+// result is published, then only does the GL uploads.
+static std::atomic<Overlay*> prepared_state{nullptr};
+static pid_t prepare_pid = 0; // Process the preparation thread was started in
+
+static void prepare_overlay() {
+    Overlay* state = new Overlay();
+    parse_config(state->settings);
+    const glm::vec3& color = state->settings.color;
+    state->layout.compile(state->settings.widgets, state->settings.alerts, state->text_batch, pack_rgba(color.r, color.g, color.b));
+    configure_background(*state);
+
+    auto atlas_start = std::chrono::steady_clock::now();
+    std::string atlas_cache = cache_dir();
+    if (!state->settings.font.empty()) {
+        std::ifstream font_file(state->settings.font, std::ios::binary);
+        if (!font_file) {
+            std::cerr << "Overlay Error: Could not open font file " << state->settings.font << ", using the embedded font." << std::endl;
+        } else {
+            std::vector<unsigned char> font_buffer(std::istreambuf_iterator<char>(font_file), {});
+            state->prepared = state->font.build(std::move(font_buffer), atlas_cache);
+        }
+    }
+    if (!state->prepared) {
+        state->prepared = state->font.build(overlay_embedded_font, overlay_embedded_font_size, atlas_cache);
+    }
+    state->atlas_build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - atlas_start).count();
+    prepared_state.store(state, std::memory_order_release);
+}
+
+static void start_preparation() {
+    prepare_pid = getpid();
+    // Detached: a process may exit before the first swap, or never draw at all
+    std::thread(prepare_overlay).detach();
+}
+
+__attribute__((constructor)) static void overlay_library_loaded() {
+    start_preparation();
+}
+
+// --- Called after the application destroys a context, on its thread ---
+static void app_context_destroyed(GLXContext context, unsigned share_group) {
+    // Its container objects and any GPU timer queries went with it
+    app_contexts.erase(context);
+    GLXContext timed = context;
+    timer_context.compare_exchange_strong(timed, nullptr);
+    // Shared objects live as long as any context of the group does
+    for (GroupSlot& slot : group_slots) {
+        GLXContext first = slot.context.load(std::memory_order_acquire);
+        if (!first || slot.share_group.load() != share_group) continue;
+        if (share_group ? !gl_share_group_alive(share_group) : first == context) slot.lost.store(true);
+    }
+}
+
+// --- Slot of the share group `context` is in, claimed on its first frame; -1 if none is free ---
+static int share_group_slot(GLXContext context) {
+    unsigned share_group = gl_share_group(context);
+    int free_slot = -1;
+    for (int i = 0; i < MAX_SHARE_GROUPS; ++i) {
+        GroupSlot& slot = group_slots[i];
+        GLXContext first = slot.context.load(std::memory_order_acquire);
+        if (!first) {
+            if (free_slot < 0) free_slot = i;
+        } else if (!slot.lost.load() && (share_group ? slot.share_group.load() == share_group : first == context)) {
+            return i;
+        }
+    }
+    if (free_slot >= 0) {
+        group_slots[free_slot].share_group.store(share_group);
+        group_slots[free_slot].context.store(context, std::memory_order_release);
+    }
+    return free_slot;
+}
+
+// --- Application context swapping now, or nullptr if the overlay can't draw from it ---
+static AppContext* current_app_context(GLXContext context) {
+    if (AppContext* app = app_contexts.find(context)) return app->group >= 0 ? app : nullptr;
+    AppContext* app = app_contexts.insert(context);
+    if (!app) return nullptr;
+    app->group = share_group_slot(context);
+    if (app->group < 0) std::cerr << "Overlay Error: Too many GL share groups, not drawing on a new one" << std::endl;
+    return app->group >= 0 ? app : nullptr;
+}
+
+// --- Drop the objects of share groups whose last context the application destroyed ---
+// The rest of the overlay (stats, capture, hitch log, GPU timing) carries on;
+// a group that comes back gets new objects on its first frame
+static void release_lost_groups() {
+    Overlay& o = *overlay_state;
+    for (int i = 0; i < MAX_SHARE_GROUPS; ++i) {
+        GroupSlot& slot = group_slots[i];
+        if (!slot.lost.exchange(false)) continue;
+        o.font.release(o.groups[i].font_texture);
+        o.groups[i] = GroupResources{};
+        if (i == o.home_group) {
+            // Our context was in that group; the next context to swap is the new home
+            o.own_context.destroy();
+            o.own_objects = ContextObjects{};
+            o.home_group = -1;
+        }
+        slot.share_group.store(0);
+        slot.context.store(nullptr, std::memory_order_release);
+        std::cout << "Overlay: GL objects lost with the application's contexts" << std::endl;
+    }
+}
+
+// --- Make `group` home: our own context joins it, and AUTO mode calibrates there ---
+static void set_home_group(Display* dpy, GLXDrawable drawable, int group) {
+    Overlay& o = *overlay_state;
+    o.home_group = group;
+    o.calibration = Overlay::Calibration{};
+    OverlaySettings::StateMode mode = o.settings.state_mode;
+    if (mode == OverlaySettings::STATE_CONTEXT && !setup_own_context(dpy, drawable)) mode = OverlaySettings::STATE_RESTORE;
+    if (mode == OverlaySettings::STATE_AUTO) setup_own_context(dpy, drawable); // Calibration skips it if this fails
+    o.active_mode = mode;
+}
+
+// --- Initialization, on the first swap after preparation finished ---
+// GL objects are per share group and made by each group's first overlay frame
+void initialize_overlay() {
+    if (!overlay_state->prepared) return;
+    // Log files are only created for processes that actually render
+    if (overlay_state->settings.hitch_threshold > 0.0f) {
+        std::string path = overlay_state->settings.hitch_log;
+        if (path.empty()) path = "/tmp/overlay_hitches_" + std::to_string(getpid()) + ".bin";
+        overlay_state->hitches.open(path.c_str(), overlay_state->settings.hitch_max, overlay_state->settings.hitch_threshold);
+    }
+    overlay_state->capture.configure(overlay_state->settings.capture);
+    overlay_state->sampler.start(overlay_state->layout.interval_ms(), overlay_state->layout.wants_cores());
+    if (glewInit() != GLEW_OK) { std::cerr << "Overlay Error: Failed to initialize GLEW" << std::endl; return; }
+    gl_shadow_on_destroy(app_context_destroyed);
     overlay_state->initialized = true;
     std::cout << "Overlay Initialized Successfully!" << std::endl;
 }
@@ -216,68 +1114,159 @@ typedef void (*glXSwapBuffers_t)(Display *dpy, GLXDrawable drawable);
 void glXSwapBuffers(Display *dpy, GLXDrawable drawable) {
     // Get the address of the original function
     static glXSwapBuffers_t original_glXSwapBuffers = (glXSwapBuffers_t)dlsym(RTLD_NEXT, "glXSwapBuffers");
-    static unsigned int width = 0, height = 0;
+    static auto last_swap_end = std::chrono::steady_clock::now();
+
+    // overlay_state and the statics here belong to one swapping thread at a
+    // time. Applications that swap from several threads at once only get the
+    // overlay on whichever holds the lock; the others just swap.
+    static std::mutex swap_mutex;
+    std::unique_lock<std::mutex> swap_lock(swap_mutex, std::try_to_lock);
+    if (!swap_lock.owns_lock()) {
+        original_glXSwapBuffers(dpy, drawable);
+        return;
+    }
+
+    // Everything between the previous swap returning and now is the game's own CPU work
+    auto hook_entry = std::chrono::steady_clock::now();
+    double app_cpu_ms = std::chrono::duration<double, std::milli>(hook_entry - last_swap_end).count();
+    static const auto first_hook_entry = hook_entry;
+    static bool first_frame_reported = false;
+
+    // Our own GL calls must not be mistaken for the application's state changes
+    gl_shadow_suspend();
 
-    // Initialize on the first call
+    // The application destroyed every context of a share group we drew in,
+    // and our objects there went with them
+    if (overlay_state) release_lost_groups();
+
+    // Initialize on the first call after preparation is done
     if (!overlay_state) {
-        Window root; int x, y; unsigned int border, depth;
-        XGetGeometry(dpy, drawable, &root, &x, &y, &width, &height, &border, &depth);
-        initialize_overlay(width, height);
+        // Threads don't survive fork(); a child that renders prepares again
+        if (prepare_pid != getpid()) {
+            delete prepared_state.exchange(nullptr);
+            start_preparation();
+        }
+        if (Overlay* prepared = prepared_state.exchange(nullptr, std::memory_order_acquire)) {
+            overlay_state.reset(prepared);
+            initialize_overlay();
+        }
     }
     
+    // Queries aren't shared between contexts; GPU time is measured in one of them
+    GLXContext context = glXGetCurrentContext();
+    bool timed_context = context && context == timer_context.load(std::memory_order_relaxed);
+
     if (overlay_state && overlay_state->initialized) {
-        // --- Save the application's current GL state ---
-        // This is crucial for not breaking the game's rendering pipeline
-        GLint last_program, last_texture, last_vao, last_blend_src_alpha, last_blend_dst_alpha;
-        glGetIntegerv(GL_CURRENT_PROGRAM, &last_program);
-        glGetIntegerv(GL_TEXTURE_BINDING_2D, &last_texture);
-        glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &last_vao);
-        glGetIntegerv(GL_BLEND_SRC_ALPHA, &last_blend_src_alpha);
-        glGetIntegerv(GL_BLEND_DST_ALPHA, &last_blend_dst_alpha);
-        GLboolean last_blend_enabled = glIsEnabled(GL_BLEND);
-
-        // --- Set up our state for rendering the overlay ---
-        glUseProgram(overlay_state->shader_program);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, overlay_state->font_texture);
-        glUniform3fv(glGetUniformLocation(overlay_state->shader_program, "textColor"), 1, glm::value_ptr(overlay_state->settings.color));
+        // The first context to swap, and another whenever that one is destroyed
+        if (context && !timed_context && !timer_context.load()) {
+            overlay_state->gpu_timer.init();
+            timer_context.store(context);
+            timed_context = true;
+        }
+        // The game's GL work for this frame has been submitted; mark its end on the GPU
+        if (timed_context) overlay_state->gpu_timer.frame_end();
+        overlay_state->capture.update(dpy);
+
+        // --- Follow drawable resizes ---
+        // glXQueryDrawable may cost a round trip to the X server, so each
+        // drawable's size is polled a few times a second, only while it swaps
+        DrawableState& d = find_drawable(dpy, drawable, hook_entry);
+        if (hook_entry >= d.next_size_poll) {
+            d.next_size_poll = hook_entry + SIZE_POLL_INTERVAL;
+            unsigned int new_width = 0, new_height = 0;
+            glXQueryDrawable(dpy, drawable, GLX_WIDTH, &new_width);
+            glXQueryDrawable(dpy, drawable, GLX_HEIGHT, &new_height);
+            if (new_width && new_height && (new_width != d.width || new_height != d.height)) {
+                resize_drawable(d, new_width, new_height);
+            }
+        }
+        overlay_state->drawable = &d;
+        place_layout(d);
 
-        // --- Update stats once per second ---
-        static auto last_time = std::chrono::high_resolution_clock::now();
+        // --- Update stats as often as the fastest widget needs them ---
+        static auto last_time = std::chrono::steady_clock::now();
         static int frame_count = 0;
         frame_count++;
-        auto current_time = std::chrono::high_resolution_clock::now();
-        if (std::chrono::duration_cast<std::chrono::seconds>(current_time - last_time) >= std::chrono::seconds{1}) {
-            overlay_state->fps = frame_count;
-            overlay_state->cpu_usage = get_cpu_usage();
+        auto current_time = std::chrono::steady_clock::now();
+        if (current_time - last_time >= std::chrono::milliseconds(overlay_state->layout.interval_ms())) {
+            update_stats_values(std::chrono::duration<double>(current_time - last_time).count(), frame_count);
             frame_count = 0;
             last_time = current_time;
         }
+        uint64_t now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(current_time.time_since_epoch()).count();
+        overlay_state->layout.update(now_ms, overlay_state->inputs, overlay_state->text_batch);
 
-        // --- Prepare and render the text ---
-        char text_buffer[128];
-        snprintf(text_buffer, sizeof(text_buffer), "FPS: %.0f | CPU: %.1f%%", overlay_state->fps, overlay_state->cpu_usage);
-
-        // Position text from the top-left corner
-        float x_pos = 10.0f;
-        float y_pos = 20.0f; // Y position is from the top because of our projection matrix
-
-        if (overlay_state->settings.position == OverlaySettings::TOP_RIGHT) {
-            float text_width = strlen(text_buffer) * 8.0f; // Simple approximation for positioning
-            x_pos = width - text_width - 10.0f;
+        // --- Render the overlay ---
+        static BenchTimer restore_bench("restore path");
+        static BenchTimer context_bench("context path");
+        static BenchTimer shadow_bench("shadow path");
+        overlay_state->app = current_app_context(context);
+        if (overlay_state->app) {
+            int group = overlay_state->app->group;
+            if (overlay_state->home_group < 0) set_home_group(dpy, drawable, group);
+            overlay_state->group = &overlay_state->groups[group];
+            // Our context and calibration live in the home group; other groups
+            // take the restore path, or the shadow path once that was picked
+            OverlaySettings::StateMode mode = overlay_state->active_mode;
+            if (group != overlay_state->home_group && mode != OverlaySettings::STATE_SHADOW) mode = OverlaySettings::STATE_RESTORE;
+            switch (mode) {
+                case OverlaySettings::STATE_AUTO:
+                    render_calibrating(drawable);
+                    break;
+                case OverlaySettings::STATE_CONTEXT:
+                    if (bench_mode()) context_bench.begin();
+                    render_with_context(drawable);
+                    if (bench_mode()) context_bench.end();
+                    break;
+                case OverlaySettings::STATE_RESTORE:
+                    if (bench_mode()) restore_bench.begin();
+                    render_with_restore();
+                    if (bench_mode()) restore_bench.end();
+                    break;
+                case OverlaySettings::STATE_SHADOW:
+                    if (bench_mode()) shadow_bench.begin();
+                    render_with_shadow();
+                    if (bench_mode()) shadow_bench.end();
+                    break;
+            }
         }
-        
-        // Call our corrected rendering function
-        render_text(text_buffer, x_pos, y_pos, 1.0f);
 
-        // --- Restore the application's original GL state ---
-        glUseProgram(last_program);
-        glBindTexture(GL_TEXTURE_2D, last_texture);
-        glBindVertexArray(last_vao);
-        if (last_blend_enabled) glEnable(GL_BLEND); else glDisable(GL_BLEND);
-        glBlendFunc(last_blend_src_alpha, last_blend_dst_alpha);
+        // Startup cost as the player sees it: from the first hooked swap to the first overlay frame
+        if (bench_mode() && !first_frame_reported) {
+            first_frame_reported = true;
+            std::cout << "Overlay bench: first overlay frame "
+                      << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - first_hook_entry).count()
+                      << " ms after first swap (font atlas " << overlay_state->atlas_build_ms << " ms, "
+                      << (overlay_state->font.loaded_from_cache() ? "cached" : "baked") << ")" << std::endl;
+        }
     }
+    gl_shadow_resume();
 
-    // Finally, call the original function to swap the buffers
+    // Finally, call the original function to swap the buffers.
+    // Time it so vsync/backpressure blocking shows up separately from game work.
+    // The lock stays held: the frame record below and the next frame's CPU time need it.
+    auto swap_begin = std::chrono::steady_clock::now();
     original_glXSwapBuffers(dpy, drawable);
+    auto swap_end = std::chrono::steady_clock::now();
+
+    if (overlay_state && overlay_state->initialized) {
+        FrameRecord frame;
+        frame.timestamp_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(swap_end.time_since_epoch()).count();
+        frame.frame_ms = std::chrono::duration<float, std::milli>(swap_end - last_swap_end).count();
+        frame.app_cpu_ms = app_cpu_ms;
+        frame.present_wait_ms = std::chrono::duration<float, std::milli>(swap_end - swap_begin).count();
+        frame.gpu_ms = overlay_state->gpu_timer.last_gpu_ms();
+
+        overlay_state->timing_accum.app_cpu_ms += frame.app_cpu_ms;
+        overlay_state->timing_accum.present_wait_ms += frame.present_wait_ms;
+        bool stutter = false;
+        if (overlay_state->settings.hitch_threshold > 0.0f) {
+            stutter = overlay_state->hitches.record(frame, overlay_state->sample);
+        }
+        overlay_state->capture.record(frame, overlay_state->sample, stutter);
+
+        // Everything the game submits from here on belongs to the next frame
+        if (timed_context) overlay_state->gpu_timer.frame_begin();
+    }
+    last_swap_end = swap_end;
 }
\ No newline at end of file
@@ -0,0 +1,22 @@
+#include <iostream>
+#include <string>
+
+#include "trace_export.hpp"
+
+// Converts a capture (overlay_capture_*.bin) to Chrome trace JSON for ui.perfetto.dev
+int main(int argc, char* argv[]) {
+    if (argc < 2 || argc > 3) {
+        std::cerr << "Usage: " << argv[0] << " <capture.bin> [trace.json]" << std::endl;
+        return 1;
+    }
+    std::string log_path = argv[1];
+    std::string json_path;
+    if (argc == 3) {
+        json_path = argv[2];
+    } else {
+        // Default to the capture name with a .json extension
+        size_t dot = log_path.rfind('.');
+        json_path = (dot == std::string::npos ? log_path : log_path.substr(0, dot)) + ".json";
+    }
+    return export_chrome_trace(log_path, json_path) ? 0 : 1;
+}
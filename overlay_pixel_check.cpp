@@ -0,0 +1,186 @@
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glx.h>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+// Checks that the overlay leaves the application's GL state alone. Like a game
+// that sets its state once, it binds a program, VAO, buffer, textures on two
+// units, blending, culling, depth and scissor tests and a viewport up front,
+// then only clears and draws every frame. Each frame is read back before its
+// swap, ahead of the overlay drawing into it, so every frame must match the
+// first one, which is drawn before the overlay ever touches the context.
+//
+//   LD_PRELOAD=./liboverlay.so OVERLAY_CONFIG=restore.ini ./overlay_pixel_check
+//
+// Run it once per state_mode, and without the preload for a reference hash.
+// Needs an X server with GLX 3.3 (Xvfb with llvmpipe is enough).
+
+static const int WIDTH = 256, HEIGHT = 256;
+static const int SCISSOR_X = 16, SCISSOR_Y = 16, SCISSOR_SIZE = 192;
+
+static const char* vertex_source = R"glsl(
+    #version 330 core
+    layout (location = 0) in vec2 pos;
+    out vec2 uv;
+    void main() {
+        uv = pos * 0.5 + 0.5;
+        gl_Position = vec4(pos, 0.5, 1.0);
+    }
+)glsl";
+
+// Samples both units, so a binding lost on either changes the output
+static const char* fragment_source = R"glsl(
+    #version 330 core
+    in vec2 uv;
+    out vec4 color;
+    uniform sampler2D unit0;
+    uniform sampler2D unit1;
+    void main() {
+        color = vec4(texture(unit0, uv).rgb * 0.5 + texture(unit1, uv).rgb * 0.5, 0.6);
+    }
+)glsl";
+
+static GLuint make_texture(uint32_t seed) {
+    std::vector<uint32_t> pixels(16 * 16);
+    for (size_t i = 0; i < pixels.size(); ++i) {
+        seed = seed * 1664525u + 1013904223u;
+        pixels[i] = seed | 0xFF000000u;
+    }
+    GLuint texture;
+    glGenTextures(1, &texture);
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 16, 16, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    return texture;
+}
+
+static GLuint compile(GLenum type, const char* source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, nullptr);
+    glCompileShader(shader);
+    return shader;
+}
+
+// FNV-1a over the scissored region
+static uint64_t hash_pixels(const std::vector<unsigned char>& pixels) {
+    uint64_t hash = 1469598103934665603ull;
+    for (unsigned char byte : pixels) hash = (hash ^ byte) * 1099511628211ull;
+    return hash;
+}
+
+int main(int argc, char* argv[]) {
+    int frames = argc > 1 ? atoi(argv[1]) : 300;
+    Display* dpy = XOpenDisplay(nullptr);
+    if (!dpy) {
+        std::cerr << "Pixel check: Could not open the X display" << std::endl;
+        return 2;
+    }
+
+    const int config_attribs[] = {
+        GLX_X_RENDERABLE, True, GLX_DRAWABLE_TYPE, GLX_WINDOW_BIT, GLX_RENDER_TYPE, GLX_RGBA_BIT,
+        GLX_RED_SIZE, 8, GLX_GREEN_SIZE, 8, GLX_BLUE_SIZE, 8, GLX_ALPHA_SIZE, 8, GLX_DEPTH_SIZE, 24,
+        GLX_DOUBLEBUFFER, True, None
+    };
+    int count = 0;
+    GLXFBConfig* configs = glXChooseFBConfig(dpy, DefaultScreen(dpy), config_attribs, &count);
+    if (!configs || count == 0) {
+        std::cerr << "Pixel check: No suitable FBConfig" << std::endl;
+        return 2;
+    }
+    GLXFBConfig config = configs[0];
+    XFree(configs);
+
+    XVisualInfo* visual = glXGetVisualFromFBConfig(dpy, config);
+    Window root = RootWindow(dpy, visual->screen);
+    XSetWindowAttributes window_attribs = {};
+    window_attribs.colormap = XCreateColormap(dpy, root, visual->visual, AllocNone);
+    window_attribs.event_mask = StructureNotifyMask;
+    Window window = XCreateWindow(dpy, root, 0, 0, WIDTH, HEIGHT, 0, visual->depth, InputOutput, visual->visual,
+                                  CWColormap | CWEventMask, &window_attribs);
+    XFree(visual);
+    XMapWindow(dpy, window);
+    for (XEvent event; XNextEvent(dpy, &event), event.type != MapNotify;) {}
+
+    // Resolved through glXGetProcAddress like a real application, so the overlay sees it
+    auto create_context = (PFNGLXCREATECONTEXTATTRIBSARBPROC)
+        glXGetProcAddressARB((const GLubyte*)"glXCreateContextAttribsARB");
+    const int context_attribs[] = {
+        GLX_CONTEXT_MAJOR_VERSION_ARB, 3, GLX_CONTEXT_MINOR_VERSION_ARB, 3,
+        GLX_CONTEXT_PROFILE_MASK_ARB, GLX_CONTEXT_CORE_PROFILE_BIT_ARB, None
+    };
+    GLXContext context = create_context ? create_context(dpy, config, nullptr, True, context_attribs) : nullptr;
+    if (!context || !glXMakeCurrent(dpy, window, context)) {
+        std::cerr << "Pixel check: Could not create a 3.3 core context" << std::endl;
+        return 2;
+    }
+
+    // --- State set once, as a game would ---
+    GLuint program = glCreateProgram();
+    glAttachShader(program, compile(GL_VERTEX_SHADER, vertex_source));
+    glAttachShader(program, compile(GL_FRAGMENT_SHADER, fragment_source));
+    glLinkProgram(program);
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "unit0"), 0);
+    glUniform1i(glGetUniformLocation(program, "unit1"), 1);
+
+    const float quad[] = { -0.8f, -0.8f, 0.8f, -0.8f, 0.8f, 0.8f, -0.8f, -0.8f, 0.8f, 0.8f, -0.8f, 0.8f };
+    GLuint vao, vbo;
+    glGenVertexArrays(1, &vao);
+    glBindVertexArray(vao);
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, nullptr);
+    glEnableVertexAttribArray(0);
+
+    glActiveTexture(GL_TEXTURE0);
+    make_texture(1);
+    glActiveTexture(GL_TEXTURE1);
+    make_texture(2); // Left active on unit 1
+
+    glEnable(GL_BLEND);
+    glBlendFuncSeparate(GL_SRC_ALPHA, GL_ONE, GL_ONE, GL_ZERO);
+    glEnable(GL_CULL_FACE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+    glEnable(GL_SCISSOR_TEST);
+    glScissor(SCISSOR_X, SCISSOR_Y, SCISSOR_SIZE, SCISSOR_SIZE);
+    glViewport(8, 8, WIDTH - 32, HEIGHT - 48);
+    glClearColor(0.1f, 0.2f, 0.3f, 1.0f);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    // --- Same frame, every frame ---
+    std::vector<unsigned char> pixels(SCISSOR_SIZE * SCISSOR_SIZE * 4);
+    uint64_t reference = 0;
+    int mismatches = 0;
+    for (int frame = 0; frame < frames; ++frame) {
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glDrawArrays(GL_TRIANGLES, 0, 6); // Blends over the first, depth-tested with LEQUAL
+        glReadPixels(SCISSOR_X, SCISSOR_Y, SCISSOR_SIZE, SCISSOR_SIZE, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+        uint64_t hash = hash_pixels(pixels);
+        if (frame == 0) {
+            reference = hash;
+        } else if (hash != reference && mismatches++ == 0) {
+            std::cerr << "Pixel check: Frame " << frame << " differs from the first frame" << std::endl;
+        }
+        glXSwapBuffers(dpy, window);
+        // Leave the overlay's background preparation time to finish
+        std::this_thread::sleep_for(std::chrono::milliseconds(16));
+    }
+
+    std::cout << "Pixel check: reference 0x" << std::hex << reference << std::dec << ", "
+              << mismatches << " of " << frames - 1 << " frames differ" << std::endl;
+    glXMakeCurrent(dpy, None, nullptr);
+    glXDestroyContext(dpy, context);
+    XDestroyWindow(dpy, window);
+    XCloseDisplay(dpy);
+    return mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,45 @@
+#include "paths.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <sys/stat.h>
+
+// $XDG_<kind>_HOME, else $HOME/<fallback>; empty if neither is set
+static std::string xdg_base(const char* variable, const char* fallback) {
+    const char* xdg = getenv(variable);
+    if (xdg && *xdg) return xdg;
+    const char* home = getenv("HOME");
+    if (home && *home) return std::string(home) + "/" + fallback;
+    return std::string();
+}
+
+std::string config_path() {
+    const char* env = getenv("OVERLAY_CONFIG");
+    if (env && *env) return env;
+    std::string base = xdg_base("XDG_CONFIG_HOME", ".config");
+    if (base.empty()) return std::string();
+    return base + "/overlay/config.ini";
+}
+
+std::string cache_dir() {
+    std::string base = xdg_base("XDG_CACHE_HOME", ".cache");
+    if (base.empty()) return std::string();
+    std::string dir = base + "/overlay";
+    if (!make_parent_dirs(dir + "/")) return std::string();
+    return dir;
+}
+
+bool make_parent_dirs(const std::string& path) {
+    size_t end = path.rfind('/');
+    if (end == std::string::npos || end == 0) return true;
+    for (size_t slash = path.find('/', 1); slash != std::string::npos && slash <= end; slash = path.find('/', slash + 1)) {
+        std::string dir = path.substr(0, slash);
+        if (mkdir(dir.c_str(), 0755) != 0 && errno != EEXIST) return false;
+    }
+    return true;
+}
+
+std::string expand_home(const std::string& path) {
+    const char* home = getenv("HOME");
+    if (path.compare(0, 2, "~/") == 0 && home && *home) return std::string(home) + path.substr(1);
+    return path;
+}
@@ -0,0 +1,23 @@
+#ifndef PATHS_HPP
+#define PATHS_HPP
+
+#include <string>
+
+// Where the overlay and the settings GUI look for their files. Nothing is
+// resolved against the working directory: a game launched from Steam or a
+// desktop entry runs with an arbitrary one.
+
+// $OVERLAY_CONFIG, else $XDG_CONFIG_HOME/overlay/config.ini,
+// else ~/.config/overlay/config.ini; empty if none can be formed
+std::string config_path();
+
+// $XDG_CACHE_HOME/overlay (or ~/.cache/overlay), created on demand; empty if unusable
+std::string cache_dir();
+
+// Creates the directory holding `path`, and its parents; false on failure
+bool make_parent_dirs(const std::string& path);
+
+// Expands a leading "~/" to $HOME, for paths given in the config
+std::string expand_home(const std::string& path);
+
+#endif // PATHS_HPP
@@ -10,10 +10,12 @@
 #include <sys/wait.h>
 #include <cstdlib> // For setenv
 
+#include "paths.hpp"
+
 // Helper to read the config file into a map
 std::map<std::string, std::string> read_config() {
     std::map<std::string, std::string> config;
-    std::ifstream config_file("config.ini");
+    std::ifstream config_file(config_path());
     std::string line;
     while (std::getline(config_file, line)) {
         std::istringstream iss(line);
@@ -31,7 +33,12 @@ std::map<std::string, std::string> read_config() {
 
 // Helper to write the config file from a map
 void write_config(const std::map<std::string, std::string>& config) {
-    std::ofstream config_file("config.ini");
+    std::string path = config_path();
+    if (path.empty() || !make_parent_dirs(path)) {
+        std::cerr << "Error: No writable config location (is $HOME set?)" << std::endl;
+        return;
+    }
+    std::ofstream config_file(path);
     config_file << "[Overlay]\n\n";
     for (const auto& pair : config) {
         config_file << pair.first << " = " << pair.second << "\n";
@@ -84,9 +91,10 @@ SettingsWindow::SettingsWindow() :
     // Position ComboBox
     m_PosComboBox.append("top_left", "Top Left");
     m_PosComboBox.append("top_right", "Top Right");
-    if (m_config["position"] == "top_right") {
-        m_PosComboBox.set_active_id("top_right");
-    } else {
+    m_PosComboBox.append("bottom_left", "Bottom Left");
+    m_PosComboBox.append("bottom_right", "Bottom Right");
+    m_PosComboBox.append("center", "Center");
+    if (!m_PosComboBox.set_active_id(m_config["position"])) {
         m_PosComboBox.set_active_id("top_left");
     }
 
@@ -127,7 +135,7 @@ void SettingsWindow::save_current_settings() {
     m_config["color_b"] = std::to_string(rgba.get_blue());
 
     write_config(m_config);
-    std::cout << "Settings saved to config.ini" << std::endl;
+    std::cout << "Settings saved to " << config_path() << std::endl;
 }
 
 void SettingsWindow::on_save_button_clicked() {
@@ -1,16 +1,28 @@
 #include "stats.hpp"
+#include <chrono>
 #include <fstream>
 #include <string>
 #include <sstream>
 #include <vector>
 #include <unistd.h>
 
-// Helper function to get CPU times from /proc/stat
-static CPU_Times get_cpu_times() {
-    std::ifstream proc_stat("/proc/stat");
-    std::string line;
-    std::getline(proc_stat, line);
-    
+const MetricInfo metric_info[METRIC_COUNT] = {
+    { "cpu_usage", "%" },
+    { "mem_usage", "%" },
+    { "gpu_busy", "%" },
+};
+
+float metric_value(const SystemSample& sample, MetricId id) {
+    switch (id) {
+        case METRIC_CPU_USAGE: return sample.cpu_usage;
+        case METRIC_MEM_USAGE: return sample.mem_usage;
+        case METRIC_GPU_BUSY: return sample.gpu_busy;
+        default: return 0.0f;
+    }
+}
+
+// Helper function to parse the times of one "cpu" line from /proc/stat
+static CPU_Times parse_cpu_times(const std::string& line) {
     std::string cpu_label;
     CPU_Times times = {};
     
@@ -20,12 +32,8 @@ static CPU_Times get_cpu_times() {
     return times;
 }
 
-double get_cpu_usage() {
-    // We need two samples to calculate a percentage
-    static CPU_Times last_times = {0, 0, 0, 0};
-    
-    CPU_Times current_times = get_cpu_times();
-
+// Busy percentage between two samples of the same CPU
+static double usage_between(const CPU_Times& last_times, const CPU_Times& current_times) {
     long long last_idle = last_times.idle;
     long long last_total = last_times.user + last_times.nice + last_times.system + last_times.idle;
 
@@ -35,11 +43,117 @@ double get_cpu_usage() {
     long long total_diff = current_total - last_total;
     long long idle_diff = current_idle - last_idle;
 
-    last_times = current_times;
-
     if (total_diff == 0) {
         return 0.0;
     }
 
     return 100.0 * (1.0 - (double)idle_diff / (double)total_diff);
-}
\ No newline at end of file
+}
+
+double get_cpu_usage(std::vector<float>* core_usage) {
+    // We need two samples to calculate a percentage
+    static CPU_Times last_times = {0, 0, 0, 0};
+    static std::vector<CPU_Times> last_core_times;
+
+    std::ifstream proc_stat("/proc/stat");
+    std::string line;
+    std::getline(proc_stat, line);
+    CPU_Times current_times = parse_cpu_times(line);
+    double usage = usage_between(last_times, current_times);
+    last_times = current_times;
+
+    // Per-CPU lines follow the total, "cpu0", "cpu1", ...
+    if (core_usage) {
+        size_t core = 0;
+        while (std::getline(proc_stat, line) && line.compare(0, 3, "cpu") == 0) {
+            CPU_Times times = parse_cpu_times(line);
+            if (core >= last_core_times.size()) last_core_times.push_back(CPU_Times{0, 0, 0, 0});
+            if (core >= core_usage->size()) core_usage->push_back(0.0f);
+            (*core_usage)[core] = (float)usage_between(last_core_times[core], times);
+            last_core_times[core] = times;
+            core++;
+        }
+        core_usage->resize(core);
+    }
+    return usage;
+}
+
+double get_mem_usage() {
+    std::ifstream meminfo("/proc/meminfo");
+    std::string key;
+    long long value = 0, total = 0, available = -1;
+    // Lines are "<Key>: <value> kB"
+    while (meminfo >> key >> value && (total == 0 || available < 0)) {
+        if (key == "MemTotal:") total = value;
+        else if (key == "MemAvailable:") available = value;
+        meminfo.ignore(64, '\n');
+    }
+    if (total <= 0 || available < 0) return 0.0;
+    return 100.0 * (double)(total - available) / (double)total;
+}
+
+double get_gpu_busy() {
+    // Looked up once: the first DRM card whose driver reports it
+    static std::string path = [] {
+        for (int card = 0; card < 8; ++card) {
+            std::string candidate = "/sys/class/drm/card" + std::to_string(card) + "/device/gpu_busy_percent";
+            if (access(candidate.c_str(), R_OK) == 0) return candidate;
+        }
+        return std::string();
+    }();
+    if (path.empty()) return -1.0;
+    std::ifstream file(path);
+    double busy = -1.0;
+    file >> busy;
+    return busy;
+}
+
+int get_core_count() {
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (int)count : 1;
+}
+// --- Background sampling ---
+SystemSampler::~SystemSampler() {
+    stop();
+}
+
+void SystemSampler::start(uint32_t interval, bool want_cores) {
+    if (sampler.joinable()) return;
+    interval_ms = interval;
+    cores = want_cores;
+    stopping = false;
+    sampler = std::thread(&SystemSampler::sampler_main, this);
+}
+
+void SystemSampler::stop() {
+    if (!sampler.joinable()) return;
+    {
+        std::lock_guard<std::mutex> lock(stop_mutex);
+        stopping = true;
+    }
+    stop_cv.notify_one();
+    sampler.join();
+}
+
+bool SystemSampler::latest(SystemSample& sample, std::vector<float>* core_usage) {
+    if (!(middle.load(std::memory_order_relaxed) & FRESH)) return false;
+    front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+    const Slot& slot = slots[front];
+    sample = slot.sample;
+    if (core_usage) core_usage->assign(slot.core_usage.begin(), slot.core_usage.end());
+    return true;
+}
+
+void SystemSampler::sampler_main() {
+    std::unique_lock<std::mutex> lock(stop_mutex);
+    while (!stopping) {
+        lock.unlock();
+        Slot& slot = slots[back];
+        slot.sample.cpu_usage = (float)get_cpu_usage(cores ? &slot.core_usage : nullptr);
+        slot.sample.mem_usage = (float)get_mem_usage();
+        slot.sample.gpu_busy = (float)get_gpu_busy();
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+        lock.lock();
+        stop_cv.wait_for(lock, std::chrono::milliseconds(interval_ms), [this] { return stopping; });
+    }
+}
@@ -2,6 +2,12 @@
 #define STATS_HPP
 
 #include <string>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
 
 // Structure to hold CPU time data from /proc/stat
 struct CPU_Times {
@@ -11,8 +17,94 @@ struct CPU_Times {
     long long idle;
 };
 
+// Per-frame timing split, measured around the hooked glXSwapBuffers
+struct FrameTiming {
+    double app_cpu_ms = 0.0;      // Previous swap returning -> this swap being called (game work)
+    double present_wait_ms = 0.0; // Time spent blocked inside the real glXSwapBuffers (vsync/backpressure)
+};
+
+// One record per presented frame, shared by everything that consumes frame timing
+struct FrameRecord {
+    uint64_t timestamp_ns;  // steady_clock time at which the real swap returned
+    float frame_ms;         // Swap-to-swap interval
+    float app_cpu_ms;
+    float present_wait_ms;
+    float gpu_ms;           // Latest resolved GPU frame time (lags by a few frames)
+};
+
+// Latest value from every collector, refreshed on the stats interval
+struct SystemSample {
+    float cpu_usage = 0.0f;
+    float mem_usage = 0.0f;
+    float gpu_busy = 0.0f;
+};
+
+// Collector metrics, by the id they are logged under
+enum MetricId : uint16_t {
+    METRIC_CPU_USAGE,
+    METRIC_MEM_USAGE,
+    METRIC_GPU_BUSY,
+    METRIC_COUNT
+};
+
+struct MetricInfo {
+    const char* name;
+    const char* unit;
+};
+
+extern const MetricInfo metric_info[METRIC_COUNT];
+float metric_value(const SystemSample& sample, MetricId id);
+
 // Function to get the current CPU usage percentage
 // This needs to be called periodically to be meaningful
-double get_cpu_usage();
+// With `core_usage`, also fills in the usage of every logical CPU, in /proc/stat order
+double get_cpu_usage(std::vector<float>* core_usage = nullptr);
+
+// Percentage of physical memory in use (not available to new allocations)
+double get_mem_usage();
+
+// Percentage of time the GPU was busy, as reported by the kernel driver
+// (gpu_busy_percent, amdgpu); negative when no driver reports it
+double get_gpu_busy();
+
+// Logical CPUs online, for sizing per-core displays
+int get_core_count();
+
+// Runs the collectors above on a background thread, so /proc and sysfs are
+// never read inside the swap hook. Results go through a triple buffer: the
+// sampler fills a back slot and swaps it into the middle with one atomic
+// exchange, and the render thread swaps it out to read, neither ever waiting.
+class SystemSampler {
+public:
+    ~SystemSampler();
+
+    // Samples every `interval_ms`, including per-core usage if `cores`
+    void start(uint32_t interval_ms, bool cores);
+    void stop();
+
+    // Copies out the newest sample (gpu_busy negative if no driver reports
+    // it); returns false if none arrived since the last call
+    bool latest(SystemSample& sample, std::vector<float>* core_usage);
+
+private:
+    struct Slot {
+        SystemSample sample;
+        std::vector<float> core_usage;
+    };
+    static constexpr uint8_t FRESH = 4; // Set on `middle` when it holds an unread sample
+
+    void sampler_main();
+
+    Slot slots[3];
+    std::atomic<uint8_t> middle{1};
+    uint8_t back = 0, front = 2; // Owned by the sampler and the reader
+    uint32_t interval_ms = 1000;
+    bool cores = false;
+
+    std::thread sampler;
+    std::mutex stop_mutex;
+    std::condition_variable stop_cv;
+    bool stopping = false;
+};
 
 #endif // STATS_HPP
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "stream_buffer.hpp"
+#include <cstring>
+#include <iostream>
+
+static constexpr GLbitfield PERSISTENT_FLAGS = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+
+void StreamBuffer::init(size_t segment_bytes) {
+    use_storage = GLEW_ARB_buffer_storage;
+    allocate(segment_bytes);
+    if (use_storage && !mapped) {
+        std::cerr << "Overlay Error: Could not map the streaming buffer, falling back to orphaning" << std::endl;
+        release();
+        use_storage = false;
+        allocate(segment_bytes);
+    }
+}
+
+void StreamBuffer::allocate(size_t segment_bytes) {
+    segment_size = segment_bytes;
+    segment = -1;
+    glGenBuffers(1, &vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    if (use_storage) {
+        glBufferStorage(GL_ARRAY_BUFFER, segment_size * SEGMENTS, NULL, PERSISTENT_FLAGS);
+        mapped = (unsigned char*)glMapBufferRange(GL_ARRAY_BUFFER, 0, segment_size * SEGMENTS, PERSISTENT_FLAGS);
+    } else {
+        glBufferData(GL_ARRAY_BUFFER, segment_size, NULL, GL_STREAM_DRAW);
+    }
+    ++buffer_generation;
+}
+
+void StreamBuffer::release() {
+    for (GLsync& fence : fences) {
+        if (fence) glDeleteSync(fence);
+        fence = nullptr;
+    }
+    if (mapped) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+        mapped = nullptr;
+    }
+    if (vbo) glDeleteBuffers(1, &vbo);
+    vbo = 0;
+}
+
+size_t StreamBuffer::write(const void* data, size_t bytes) {
+    if (!use_storage) {
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        if (bytes > segment_size) {
+            while (segment_size < bytes) segment_size *= 2;
+        }
+        // Orphan: the driver hands us fresh storage instead of waiting on draws still reading the old one
+        glBufferData(GL_ARRAY_BUFFER, segment_size, NULL, GL_STREAM_DRAW);
+        glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, data);
+        return 0;
+    }
+
+    if (bytes > segment_size) {
+        // Immutable storage can't grow in place; start a larger ring
+        size_t size = segment_size;
+        while (size < bytes) size *= 2;
+        release();
+        allocate(size);
+    } else if (segment >= 0) {
+        // Every draw that reads the segment we're leaving has been issued by now
+        fences[segment] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+
+    segment = (segment + 1) % SEGMENTS;
+    if (GLsync fence = fences[segment]) {
+        // Written SEGMENTS updates ago, so this is almost always already signaled
+        while (glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(fence);
+        fences[segment] = nullptr;
+    }
+    size_t offset = (size_t)segment * segment_size;
+    memcpy(mapped + offset, data, bytes);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    return offset;
+}
@@ -0,0 +1,42 @@
+#ifndef STREAM_BUFFER_HPP
+#define STREAM_BUFFER_HPP
+
+#include <GL/glew.h>
+#include <cstddef>
+
+// Vertex buffer for geometry rewritten from the CPU. With ARB_buffer_storage
+// it's a persistently, coherently mapped ring of SEGMENTS regions: each write
+// goes to the next region after its fence shows the GPU is done with it, so a
+// write is a plain memcpy with no driver call. Without it, every write orphans
+// the buffer and uploads with glBufferSubData.
+class StreamBuffer {
+public:
+    static constexpr int SEGMENTS = 3;
+
+    // `segment_bytes` should be a multiple of the vertex size so offsets
+    // returned by write() map to whole vertices
+    void init(size_t segment_bytes);
+
+    // Copies `bytes` into the buffer and returns the byte offset it landed at.
+    // Leaves the buffer bound to GL_ARRAY_BUFFER.
+    size_t write(const void* data, size_t bytes);
+
+    GLuint buffer() const { return vbo; }
+    // Bumped whenever buffer() changes (a persistent ring has to be recreated
+    // to grow), so VAOs know to re-point their attributes
+    unsigned generation() const { return buffer_generation; }
+
+private:
+    void allocate(size_t segment_bytes);
+    void release();
+
+    GLuint vbo = 0;
+    unsigned char* mapped = nullptr;
+    size_t segment_size = 0;
+    int segment = -1; // Segment holding the last write
+    GLsync fences[SEGMENTS] = {};
+    bool use_storage = false;
+    unsigned buffer_generation = 0;
+};
+
+#endif // STREAM_BUFFER_HPP
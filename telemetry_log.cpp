@@ -0,0 +1,245 @@
+#include "telemetry_log.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static constexpr auto FLUSH_INTERVAL = std::chrono::milliseconds(20);
+
+static size_t align4(size_t size) {
+    return (size + 3) & ~size_t(3);
+}
+
+TelemetryLog::~TelemetryLog() {
+    close();
+}
+
+bool TelemetryLog::open(const std::string& path, size_t requested_chunk_size) {
+    size_t page = sysconf(_SC_PAGESIZE);
+    chunk_size = std::max(page, (requested_chunk_size + page - 1) / page * page);
+
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        std::cerr << "Overlay Error: Could not create telemetry log " << path << std::endl;
+        return false;
+    }
+    current = map_chunk(0);
+    unsigned char* second = map_chunk(1);
+    if (!current || !second) {
+        std::cerr << "Overlay Error: Could not map telemetry log " << path << ": " << strerror(errno) << std::endl;
+        if (current) munmap(current, chunk_size);
+        if (second) munmap(second, chunk_size);
+        current = nullptr;
+        ::close(fd);
+        fd = -1;
+        return false;
+    }
+    next_chunk.store(second, std::memory_order_relaxed);
+    mapped_chunks = 2;
+    current_index = 0;
+
+    // Header and schema go at the start of the first chunk
+    timespec wall;
+    clock_gettime(CLOCK_REALTIME, &wall);
+    LogHeader header = {};
+    std::memcpy(header.magic, LOG_MAGIC, sizeof(header.magic));
+    header.version = LOG_VERSION;
+    header.header_size = sizeof(LogHeader);
+    header.metric_count = METRIC_COUNT;
+    header.schema_entry_size = sizeof(SchemaEntry);
+    header.chunk_size = chunk_size;
+    header.wall_clock_ns = (int64_t)wall.tv_sec * 1000000000LL + wall.tv_nsec;
+    header.steady_clock_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    std::memcpy(current, &header, sizeof(header));
+    current_pos = sizeof(header);
+
+    for (uint16_t id = 0; id < METRIC_COUNT; id++) {
+        SchemaEntry entry = {};
+        entry.id = id;
+        strncpy(entry.name, metric_info[id].name, sizeof(entry.name) - 1);
+        strncpy(entry.unit, metric_info[id].unit, sizeof(entry.unit) - 1);
+        std::memcpy(current + current_pos, &entry, sizeof(entry));
+        current_pos += sizeof(entry);
+    }
+    current_pos = align4(current_pos);
+    committed.store(current_pos, std::memory_order_release);
+
+    stopping = false;
+    flusher = std::thread(&TelemetryLog::flush_main, this);
+    return true;
+}
+
+unsigned char* TelemetryLog::map_chunk(size_t index) {
+    off_t offset = (off_t)(index * chunk_size);
+    // Reserve the blocks up front. A sparse extension would map too, but the
+    // producer's memcpy into it raises SIGBUS once the disk is full.
+    // Sets errno on failure, like mmap
+    if (int error = posix_fallocate(fd, offset, chunk_size)) {
+        errno = error;
+        return nullptr;
+    }
+    void* map = mmap(nullptr, chunk_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, offset);
+    return map == MAP_FAILED ? nullptr : static_cast<unsigned char*>(map);
+}
+
+void TelemetryLog::append_frame(const FrameRecord& frame, uint32_t flags) {
+    LogFrame record;
+    record.frame = frame;
+    record.flags = flags;
+    append(RECORD_FRAME, &record, sizeof(record));
+}
+
+void TelemetryLog::append_sample(uint64_t timestamp_ns, uint16_t metric, float value) {
+    LogSample record;
+    record.timestamp_ns = timestamp_ns;
+    record.metric = metric;
+    record.reserved = 0;
+    record.value = value;
+    append(RECORD_SAMPLE, &record, sizeof(record));
+}
+
+void TelemetryLog::append(RecordType type, const void* payload, size_t payload_size) {
+    if (!current) return;
+    size_t record_size = align4(sizeof(RecordHeader) + payload_size);
+    // After a drop, smaller records that would still fit wait for the next
+    // chunk too, so the log never holds records out of order
+    if ((dropping || current_pos + record_size > chunk_size) && !switch_chunk()) {
+        dropping = true;
+        dropped_records.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    dropping = false;
+    RecordHeader header = { (uint16_t)type, (uint16_t)record_size };
+    std::memcpy(current + current_pos, &header, sizeof(header));
+    std::memcpy(current + current_pos + sizeof(header), payload, payload_size);
+    current_pos += record_size;
+    committed.store(current_index * chunk_size + current_pos, std::memory_order_release);
+}
+
+bool TelemetryLog::switch_chunk() {
+    unsigned char* next = next_chunk.exchange(nullptr, std::memory_order_acq_rel);
+    if (!next) return false; // Flush thread hasn't mapped the next chunk yet
+
+    // Readers skip from a pad record straight to the next chunk boundary
+    if (current_pos + sizeof(RecordHeader) <= chunk_size) {
+        RecordHeader pad = { RECORD_PAD, sizeof(RecordHeader) };
+        std::memcpy(current + current_pos, &pad, sizeof(pad));
+    }
+    retired_chunk.store(current, std::memory_order_release);
+    current = next;
+    current_index++;
+    current_pos = 0;
+    return true;
+}
+
+void TelemetryLog::flush_main() {
+    bool map_failed = false;
+    while (true) {
+        bool stop = stopping.load(std::memory_order_acquire);
+        if (unsigned char* retired = retired_chunk.exchange(nullptr, std::memory_order_acq_rel)) {
+            msync(retired, chunk_size, MS_ASYNC);
+            munmap(retired, chunk_size);
+        }
+        if (stop) break;
+        // The producer retires one chunk per next chunk it takes. Publishing the
+        // next one only while the retired slot is empty keeps a single slot
+        // enough: a chunk retired after the exchange above waits a round.
+        if (!next_chunk.load(std::memory_order_acquire) && !retired_chunk.load(std::memory_order_acquire)) {
+            if (unsigned char* chunk = map_chunk(mapped_chunks)) {
+                mapped_chunks++;
+                next_chunk.store(chunk, std::memory_order_release);
+                map_failed = false;
+            } else if (!map_failed) {
+                // Retried every interval; the producer drops records meanwhile
+                std::cerr << "Overlay Error: Could not map the next telemetry log chunk: " << strerror(errno) << std::endl;
+                map_failed = true;
+            }
+        }
+        std::this_thread::sleep_for(FLUSH_INTERVAL);
+    }
+    if (unsigned char* unused = next_chunk.exchange(nullptr, std::memory_order_acq_rel)) {
+        munmap(unused, chunk_size);
+    }
+}
+
+void TelemetryLog::close() {
+    if (fd < 0) return;
+    stopping.store(true, std::memory_order_release);
+    if (flusher.joinable()) flusher.join();
+    if (current) {
+        msync(current, chunk_size, MS_SYNC);
+        munmap(current, chunk_size);
+        current = nullptr;
+    }
+    // Drop the preallocated tail so the file ends at the last record
+    if (ftruncate(fd, committed.load(std::memory_order_acquire)) != 0) {
+        std::cerr << "Overlay Error: Could not truncate telemetry log" << std::endl;
+    }
+    ::close(fd);
+    fd = -1;
+}
+
+// --- Reader ---
+TelemetryReader::~TelemetryReader() {
+    if (file) fclose(file);
+}
+
+bool TelemetryReader::open(const std::string& path) {
+    file = fopen(path.c_str(), "rb");
+    if (!file) return false;
+    if (fread(&log_header, sizeof(log_header), 1, file) != 1 ||
+        std::memcmp(log_header.magic, LOG_MAGIC, sizeof(LOG_MAGIC)) != 0 ||
+        log_header.version > LOG_VERSION || log_header.chunk_size == 0) {
+        return false;
+    }
+    fseek(file, log_header.header_size, SEEK_SET);
+    scratch.resize(std::max<size_t>(log_header.schema_entry_size, sizeof(SchemaEntry)));
+    for (uint32_t i = 0; i < log_header.metric_count; i++) {
+        if (fread(scratch.data(), log_header.schema_entry_size, 1, file) != 1) return false;
+        SchemaEntry entry = {};
+        std::memcpy(&entry, scratch.data(), std::min<size_t>(log_header.schema_entry_size, sizeof(entry)));
+        entry.name[sizeof(entry.name) - 1] = '\0';
+        entry.unit[sizeof(entry.unit) - 1] = '\0';
+        log_schema.push_back(entry);
+    }
+    fseek(file, align4(log_header.header_size + (size_t)log_header.metric_count * log_header.schema_entry_size), SEEK_SET);
+    return true;
+}
+
+bool TelemetryReader::next(Record& record) {
+    while (file) {
+        long offset = ftell(file);
+        RecordHeader header;
+        if (fread(&header, sizeof(header), 1, file) != 1) return false;
+        if (header.type == RECORD_END || header.size < sizeof(header)) return false;
+        if (header.type == RECORD_PAD) {
+            fseek(file, (offset / log_header.chunk_size + 1) * log_header.chunk_size, SEEK_SET);
+            continue;
+        }
+        size_t payload_size = header.size - sizeof(header);
+        scratch.resize(std::max(scratch.size(), payload_size));
+        if (fread(scratch.data(), 1, payload_size, file) != payload_size) return false;
+
+        // Newer writers may append fields; copy what we know and zero the rest
+        if (header.type == RECORD_FRAME) {
+            record = Record{};
+            record.type = RECORD_FRAME;
+            std::memcpy(&record.frame, scratch.data(), std::min(payload_size, sizeof(record.frame)));
+            return true;
+        }
+        if (header.type == RECORD_SAMPLE) {
+            record = Record{};
+            record.type = RECORD_SAMPLE;
+            std::memcpy(&record.sample, scratch.data(), std::min(payload_size, sizeof(record.sample)));
+            return true;
+        }
+        // Unknown record type from a newer writer: skip it
+    }
+    return false;
+}
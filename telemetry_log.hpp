@@ -0,0 +1,139 @@
+#ifndef TELEMETRY_LOG_HPP
+#define TELEMETRY_LOG_HPP
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "stats.hpp"
+
+// --- Binary telemetry log format ---
+// LogHeader, then header.metric_count SchemaEntry, then a stream of records.
+// Every record starts with a RecordHeader and is padded to a multiple of 4 bytes.
+// Readers must skip record types they don't know using `size`, and must accept
+// known records that are larger than they expect (fields are only ever appended).
+// LOG_VERSION only changes when an existing field changes meaning.
+static constexpr char LOG_MAGIC[4] = { 'O', 'V', 'T', 'L' };
+static constexpr uint32_t LOG_VERSION = 1;
+
+struct LogHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t header_size;      // Offset of the first SchemaEntry
+    uint32_t metric_count;
+    uint32_t schema_entry_size;
+    uint32_t chunk_size;
+    int64_t wall_clock_ns;     // CLOCK_REALTIME when the log was opened...
+    uint64_t steady_clock_ns;  // ...and the matching steady_clock time used by record timestamps
+};
+
+struct SchemaEntry {
+    uint16_t id;
+    char name[30];
+    char unit[8];
+};
+
+enum RecordType : uint16_t {
+    RECORD_END = 0,    // Unwritten space; the log stops here
+    RECORD_PAD = 1,    // Filler up to the end of a chunk
+    RECORD_FRAME = 2,  // LogFrame
+    RECORD_SAMPLE = 3, // LogSample
+};
+
+struct RecordHeader {
+    uint16_t type;
+    uint16_t size; // Whole record, header included
+};
+
+enum LogFrameFlags : uint32_t {
+    FRAME_FLAG_STUTTER = 1 << 0,
+};
+
+struct LogFrame {
+    FrameRecord frame;
+    uint32_t flags;
+};
+
+struct LogSample {
+    uint64_t timestamp_ns;
+    uint16_t metric;
+    uint16_t reserved;
+    float value;
+};
+
+// Writes the log through mmap'd chunks of the file. append_*() is a memcpy into
+// the current chunk; a flush thread preallocates and maps the next chunk ahead
+// of time and syncs and unmaps retired ones, so the caller never makes a syscall.
+// Records are dropped (and counted) if the flush thread falls behind, from
+// the first one that doesn't fit until the next chunk is mapped.
+class TelemetryLog {
+public:
+    static constexpr size_t DEFAULT_CHUNK_SIZE = 4 << 20;
+
+    ~TelemetryLog();
+
+    bool open(const std::string& path, size_t chunk_size = DEFAULT_CHUNK_SIZE);
+    // Stops the flush thread and truncates the file to what was written.
+    // The producer must have stopped appending.
+    void close();
+
+    void append_frame(const FrameRecord& frame, uint32_t flags);
+    void append_sample(uint64_t timestamp_ns, uint16_t metric, float value);
+
+    size_t dropped() const { return dropped_records.load(std::memory_order_relaxed); }
+
+private:
+    void append(RecordType type, const void* payload, size_t payload_size);
+    bool switch_chunk();
+    unsigned char* map_chunk(size_t index);
+    void flush_main();
+
+    int fd = -1;
+    size_t chunk_size = 0;
+
+    // Producer side
+    unsigned char* current = nullptr;
+    size_t current_index = 0;
+    size_t current_pos = 0;
+    bool dropping = false; // Records are dropped until the next chunk
+    std::atomic<size_t> dropped_records{0};
+
+    // Handoff between producer and flush thread
+    std::atomic<unsigned char*> next_chunk{nullptr}; // Mapped and ready, published by the flush thread
+    std::atomic<unsigned char*> retired_chunk{nullptr}; // Full, waiting to be synced and unmapped
+    std::atomic<uint64_t> committed{0}; // File offset of the end of the last complete record
+
+    std::thread flusher;
+    std::atomic<bool> stopping{false};
+    size_t mapped_chunks = 0; // Owned by the flush thread once it runs
+};
+
+// Streams records back out of a log file without loading it into memory
+class TelemetryReader {
+public:
+    struct Record {
+        RecordType type;
+        LogFrame frame;
+        LogSample sample;
+    };
+
+    ~TelemetryReader();
+
+    bool open(const std::string& path);
+    // Returns false at the end of the log
+    bool next(Record& record);
+
+    const LogHeader& header() const { return log_header; }
+    const std::vector<SchemaEntry>& schema() const { return log_schema; }
+
+private:
+    FILE* file = nullptr;
+    LogHeader log_header = {};
+    std::vector<SchemaEntry> log_schema;
+    std::vector<unsigned char> scratch;
+};
+
+#endif // TELEMETRY_LOG_HPP
@@ -0,0 +1,391 @@
+#include "text_batch.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+
+static uint16_t unorm16(float v) {
+    return (uint16_t)std::lround(std::min(std::max(v, 0.0f), 1.0f) * 65535.0f);
+}
+
+static uint32_t unorm8(float v) {
+    return (uint32_t)std::lround(std::min(std::max(v, 0.0f), 1.0f) * 255.0f);
+}
+
+uint32_t pack_rgba(float r, float g, float b, float a) {
+    return unorm8(r) | unorm8(g) << 8 | unorm8(b) << 16 | unorm8(a) << 24;
+}
+
+uint32_t parse_rgba(const std::string& text) {
+    if (text.size() != 7 && text.size() != 9) return 0;
+    if (text[0] != '#' || text.find_first_not_of("0123456789abcdefABCDEF", 1) != std::string::npos) return 0;
+    uint32_t hex = (uint32_t)std::strtoul(text.c_str() + 1, nullptr, 16);
+    if (text.size() == 7) hex = hex << 8 | 0xFF;
+    // Bytes are r, g, b, a from the most significant; rgba keeps red lowest
+    return (hex >> 24) | (hex >> 8 & 0xFF00) | (hex << 8 & 0xFF0000) | (hex << 24);
+}
+
+GlyphInstance solid_quad(float x, float y, float w, float h, uint32_t rgba, float radius) {
+    GlyphInstance g;
+    g.x = x;
+    g.y = y;
+    g.w = (uint16_t)std::lround(std::min(std::max(w, 0.0f) * TextBatch::SIZE_UNITS, 65535.0f));
+    g.h = (uint16_t)std::lround(std::min(std::max(h, 0.0f) * TextBatch::SIZE_UNITS, 65535.0f));
+    g.s0 = 0xFFFF;
+    g.t0 = (uint16_t)std::lround(std::min(std::max(radius, 0.0f) * TextBatch::SIZE_UNITS, 65535.0f));
+    g.s1 = 0;
+    g.t1 = 0;
+    g.rgba = rgba;
+    return g;
+}
+
+static bool is_digit(uint32_t c) {
+    return c >= '0' && c <= '9';
+}
+
+// Whether two strings are the same apart from which digits they hold
+static bool same_shape(const std::string& a, const char* b) {
+    size_t i = 0;
+    for (; i < a.size() && b[i]; ++i) {
+        if (a[i] != b[i] && !(is_digit((unsigned char)a[i]) && is_digit((unsigned char)b[i]))) return false;
+    }
+    return i == a.size() && !b[i];
+}
+
+int TextBatch::add_run() {
+    runs.emplace_back();
+    any_dirty = true;
+    return (int)runs.size() - 1;
+}
+
+void TextBatch::set_text(int run, const char* text, float x, float y, float scale) {
+    TextRun& r = runs[run];
+    bool moved = r.x != x || r.y != y || r.scale != scale;
+    if (!moved && r.text == text) return;
+    if (!moved && patch_digits(r, text)) {
+        any_dirty = true;
+        return;
+    }
+    r.text = text;
+    r.x = x;
+    r.y = y;
+    r.scale = scale;
+    r.dirty = true;
+    any_dirty = true;
+}
+
+// Rewrites the instances of the digits that changed, if that is all that did
+bool TextBatch::patch_digits(TextRun& run, const char* text) {
+    if (run.dirty || !run.digits_patchable || !same_shape(run.text, text)) return false;
+    for (const DigitSlot& slot : run.digit_slots) {
+        char c = text[slot.byte];
+        if (c == run.text[slot.byte]) continue;
+        GlyphInstance& g = instances[run.first + slot.instance];
+        g = run.digit_quads[c - '0'];
+        g.x += slot.pen_x;
+        g.y += slot.baseline;
+        g.rgba = color_at(run, slot.byte);
+    }
+    run.text = text;
+    return true;
+}
+
+void TextBatch::set_color(int run, uint32_t rgba) {
+    TextRun& r = runs[run];
+    if (r.rgba == rgba) return;
+    r.rgba = rgba;
+    r.dirty = true;
+    any_dirty = true;
+}
+
+void TextBatch::set_spans(int run, const ColorSpan* spans, size_t count) {
+    TextRun& r = runs[run];
+    if (r.spans.size() == count && memcmp(r.spans.data(), spans, count * sizeof(ColorSpan)) == 0) return;
+    r.spans.assign(spans, spans + count);
+    r.dirty = true;
+    any_dirty = true;
+}
+
+uint32_t TextBatch::color_at(const TextRun& run, uint32_t byte) {
+    for (const ColorSpan& span : run.spans) {
+        if (byte < span.begin) break;
+        if (byte < span.end) return span.rgba;
+    }
+    return run.rgba;
+}
+
+void TextBatch::set_align(int run, float align_x, float align_y) {
+    TextRun& r = runs[run];
+    if (r.align_x == align_x && r.align_y == align_y) return;
+    r.align_x = align_x;
+    r.align_y = align_y;
+    r.dirty = true;
+    any_dirty = true;
+}
+
+void TextBatch::set_background(uint32_t rgba, float padding, float radius) {
+    if (rgba >> 24 == 0) rgba = 0;
+    if (background_rgba == rgba && background_padding == padding && background_radius == radius) return;
+    // Turning it on or off adds or removes instances[0]
+    if (!background_rgba != !rgba) background_changed = true;
+    background_rgba = rgba;
+    background_padding = padding;
+    background_radius = radius;
+    any_dirty = true;
+}
+
+void TextBatch::set_quads(int run, const GlyphInstance* quads, size_t count) {
+    TextRun& r = runs[run];
+    if (r.has_quads && r.quads.size() == count && memcmp(r.quads.data(), quads, count * sizeof(GlyphInstance)) == 0) return;
+    r.has_quads = true;
+    r.quads.assign(quads, quads + count);
+    r.dirty = true;
+    any_dirty = true;
+}
+
+
+// Decodes one UTF-8 sequence; malformed input becomes U+FFFD
+static uint32_t next_codepoint(const unsigned char*& s) {
+    uint32_t c = *s++;
+    if (c < 0x80) return c;
+    int extra = c >= 0xF8 ? -1 : c >= 0xF0 ? 3 : c >= 0xE0 ? 2 : c >= 0xC0 ? 1 : -1;
+    if (extra < 0) return 0xFFFD;
+    c &= 0x3F >> extra;
+    for (; extra > 0; --extra) {
+        if ((*s & 0xC0) != 0x80) return 0xFFFD;
+        c = (c << 6) | (*s++ & 0x3F);
+    }
+    return c;
+}
+
+// Exact pen advances of each line, in screen pixels. Every digit takes the
+// same slot, so the size only depends on where the digits are; it is cached
+// by that and changing numbers neither re-measure nor move the text.
+void TextBatch::measure(FontAtlas& atlas, TextRun& run) {
+    if (run.measured_scale == run.scale && same_shape(run.measured_text, run.text.c_str())) return;
+    const float k = run.scale * font_size / FontAtlas::PIXEL_HEIGHT;
+    run.line_widths.assign(1, 0.0f);
+    for (const unsigned char* s = (const unsigned char*)run.text.c_str(); *s;) {
+        uint32_t c = next_codepoint(s);
+        if (c == '\n') {
+            run.line_widths.push_back(0.0f);
+            continue;
+        }
+        if (c < 32) continue;
+        const AtlasGlyph* a = atlas.glyph(c);
+        if (!a) continue;
+        run.line_widths.back() += (is_digit(c) ? atlas.digit_advance() : a->advance) * k;
+    }
+    run.height = (run.line_widths.size() - 1) * line_height * run.scale + (atlas.ascent() + atlas.descent()) * k;
+    run.measured_text = run.text;
+    run.measured_scale = run.scale;
+}
+
+// The instance for a glyph with the pen at the origin; `shift` moves it right, in atlas pixels
+static GlyphInstance place_glyph(const AtlasGlyph& a, float k, float shift, uint32_t rgba) {
+    const float texel = 1.0f / FontAtlas::SIZE;
+    GlyphInstance g;
+    g.x = (shift + a.xoff) * k;
+    g.y = a.yoff * k;
+    g.w = (uint16_t)std::lround(a.w * k * TextBatch::SIZE_UNITS);
+    g.h = (uint16_t)std::lround(a.h * k * TextBatch::SIZE_UNITS);
+    g.s0 = unorm16(a.x * texel);
+    g.t0 = unorm16(a.y * texel);
+    g.s1 = unorm16((a.x + a.w) * texel);
+    g.t1 = unorm16((a.y + a.h) * texel);
+    g.rgba = rgba;
+    return g;
+}
+
+void TextBatch::layout(FontAtlas& atlas, TextRun& run, std::vector<GlyphInstance>& out) {
+    run.digit_slots.clear();
+    run.digits_patchable = false;
+    run.box_x0 = run.box_y0 = INFINITY;
+    run.box_x1 = run.box_y1 = -INFINITY;
+    if (run.has_quads) {
+        out.insert(out.end(), run.quads.begin(), run.quads.end());
+        for (const GlyphInstance& g : run.quads) {
+            run.box_x0 = std::min(run.box_x0, g.x);
+            run.box_y0 = std::min(run.box_y0, g.y);
+            run.box_x1 = std::max(run.box_x1, g.x + g.w / SIZE_UNITS);
+            run.box_y1 = std::max(run.box_y1, g.y + g.h / SIZE_UNITS);
+        }
+        return;
+    }
+    // Atlas pixels to screen pixels; the distance field keeps edges sharp at any factor
+    const float k = run.scale * font_size / FontAtlas::PIXEL_HEIGHT;
+    measure(atlas, run);
+
+    // Digits are centered in a slot as wide as the widest one
+    if (run.text.find_first_of("0123456789") != std::string::npos) {
+        run.digits_patchable = true;
+        for (int d = 0; d < 10; ++d) {
+            const AtlasGlyph* a = atlas.glyph('0' + d);
+            if (!a || !a->w) {
+                run.digits_patchable = false; // Every digit needs an instance to swap
+                continue;
+            }
+            run.digit_quads[d] = place_glyph(*a, k, (atlas.digit_advance() - a->advance) * 0.5f, run.rgba);
+        }
+    }
+
+    const size_t first = out.size();
+    size_t line = 0;
+    float x = run.x - run.align_x * run.line_widths[0];
+    float y = run.y - run.align_y * run.height + atlas.ascent() * k; // First baseline
+    if (!run.text.empty()) {
+        for (float width : run.line_widths) {
+            run.box_x0 = std::min(run.box_x0, run.x - run.align_x * width);
+            run.box_x1 = std::max(run.box_x1, run.x + (1.0f - run.align_x) * width);
+        }
+        run.box_y0 = run.y - run.align_y * run.height;
+        run.box_y1 = run.box_y0 + run.height;
+    }
+    const unsigned char* text = (const unsigned char*)run.text.c_str();
+    const ColorSpan* span = run.spans.data();
+    const ColorSpan* const spans_end = span + run.spans.size();
+    for (const unsigned char* s = text; *s;) {
+        uint32_t byte = (uint32_t)(s - text);
+        uint32_t c = next_codepoint(s);
+        while (span != spans_end && span->end <= byte) ++span;
+        uint32_t rgba = span != spans_end && span->begin <= byte ? span->rgba : run.rgba;
+        if (c == '\n') {
+            x = run.x - run.align_x * run.line_widths[++line];
+            y += line_height * run.scale;
+            continue;
+        }
+        if (c < 32) continue;
+        const AtlasGlyph* a = atlas.glyph(c);
+        if (!a) continue;
+
+        float advance = a->advance;
+        GlyphInstance g;
+        if (is_digit(c) && run.digits_patchable) {
+            advance = atlas.digit_advance();
+            run.digit_slots.push_back(DigitSlot{byte, (uint32_t)(out.size() - first), x, y});
+            g = run.digit_quads[c - '0'];
+            g.rgba = rgba;
+        } else if (is_digit(c)) {
+            advance = atlas.digit_advance();
+            g = place_glyph(*a, k, (advance - a->advance) * 0.5f, rgba);
+        } else {
+            g = place_glyph(*a, k, 0.0f, rgba);
+        }
+        if (a->w) { // Blanks only advance
+            g.x += x;
+            g.y += y;
+            out.push_back(g);
+        }
+        x += advance * k;
+    }
+}
+
+bool TextBatch::update(FontAtlas& atlas) {
+    // A repack moved glyphs that unchanged runs still point at
+    if (atlas.generation() != atlas_generation) any_dirty = true;
+    if (!any_dirty) return false;
+    atlas.begin_pass();
+
+    // A run that keeps its glyph count (the usual case for changing numbers)
+    // is patched in place; anything else relays out the whole batch
+    bool relayout = atlas.generation() != atlas_generation || background_changed;
+    for (TextRun& run : runs) {
+        if (relayout) break;
+        if (!run.dirty) continue;
+        scratch.clear();
+        layout(atlas, run, scratch);
+        if (scratch.size() != run.count) {
+            relayout = true;
+            break;
+        }
+        std::copy(scratch.begin(), scratch.end(), instances.begin() + run.first);
+        run.dirty = false;
+    }
+
+    // Adding glyphs can repack the atlas under what was just laid out. Glyphs
+    // used in this pass survive a repack, so one more full pass settles it.
+    if (relayout || atlas.generation() != atlas_generation) {
+        for (int pass = 0; pass < 2; ++pass) {
+            atlas_generation = atlas.generation();
+            instances.clear();
+            if (background_rgba) instances.emplace_back(); // Placed by compute_bounds()
+            for (TextRun& run : runs) {
+                run.first = instances.size();
+                layout(atlas, run, instances);
+                run.count = instances.size() - run.first;
+                run.dirty = false;
+            }
+            if (atlas.generation() == atlas_generation) break;
+        }
+        atlas_generation = atlas.generation();
+        background_changed = false;
+    }
+    compute_bounds();
+    any_dirty = false;
+    ++batch_revision;
+    return true;
+}
+
+size_t TextBatch::write(StreamBuffer& stream) const {
+    // The whole batch is a few KB; rewriting it into a fresh stream region
+    // avoids ever touching memory a pending draw may still read
+    if (instances.empty()) return 0;
+    size_t offset = stream.write(instances.data(), instances.size() * sizeof(GlyphInstance));
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return offset;
+}
+
+void TextBatch::compute_bounds() {
+    size_t content = background_rgba ? 1 : 0;
+    min_x = min_y = INFINITY;
+    max_x = max_y = -INFINITY;
+    for (size_t i = content; i < instances.size(); ++i) {
+        const GlyphInstance& g = instances[i];
+        min_x = std::min(min_x, g.x);
+        max_x = std::max(max_x, g.x + g.w / SIZE_UNITS);
+        min_y = std::min(min_y, g.y);
+        max_y = std::max(max_y, g.y + g.h / SIZE_UNITS);
+    }
+
+    if (background_rgba) {
+        float x0 = INFINITY, y0 = INFINITY, x1 = -INFINITY, y1 = -INFINITY;
+        for (const TextRun& run : runs) {
+            if (run.box_x0 >= run.box_x1) continue;
+            x0 = std::min(x0, run.box_x0);
+            y0 = std::min(y0, run.box_y0);
+            x1 = std::max(x1, run.box_x1);
+            y1 = std::max(y1, run.box_y1);
+        }
+        if (x0 < x1) {
+            float p = background_padding;
+            instances[0] = solid_quad(std::floor(x0 - p), std::floor(y0 - p), std::ceil(x1 + p) - std::floor(x0 - p),
+                                      std::ceil(y1 + p) - std::floor(y0 - p), background_rgba, background_radius);
+            const GlyphInstance& g = instances[0];
+            min_x = std::min(min_x, g.x);
+            max_x = std::max(max_x, g.x + g.w / SIZE_UNITS);
+            min_y = std::min(min_y, g.y);
+            max_y = std::max(max_y, g.y + g.h / SIZE_UNITS);
+        } else {
+            instances[0] = solid_quad(0.0f, 0.0f, 0.0f, 0.0f, 0);
+        }
+    }
+    if (min_x > max_x) min_x = min_y = max_x = max_y = 0.0f;
+}
+
+void TextBatch::draw(GLuint vao) const {
+    if (instances.empty()) return;
+    glBindVertexArray(vao);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, VERTICES_PER_GLYPH, (GLsizei)instances.size());
+    glBindVertexArray(0);
+}
+
+void TextBatch::draw_per_glyph(GLuint vao, GLuint glyph_vbo) const {
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, glyph_vbo);
+    for (const GlyphInstance& glyph : instances) {
+        glBufferSubData(GL_ARRAY_BUFFER, 0, sizeof(glyph), &glyph);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, VERTICES_PER_GLYPH, 1);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindVertexArray(0);
+}
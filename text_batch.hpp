@@ -0,0 +1,156 @@
+#ifndef TEXT_BATCH_HPP
+#define TEXT_BATCH_HPP
+
+#include <GL/glew.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "font_atlas.hpp"
+#include "stream_buffer.hpp"
+
+// One glyph, drawn as an instance of a unit quad that the vertex shader
+// expands; 24 bytes instead of six 16-byte vertices
+struct GlyphInstance {
+    float x, y;                 // Top-left corner, screen pixels
+    uint16_t w, h;              // Quad size in 1/8 pixels
+    uint16_t s0, t0, s1, t1;    // Atlas rectangle, normalized to 0..65535
+    uint32_t rgba;              // Color, red in the lowest byte
+};
+static_assert(sizeof(GlyphInstance) == 24, "GlyphInstance must stay tightly packed");
+
+// Packs a 0..1 color into GlyphInstance::rgba
+uint32_t pack_rgba(float r, float g, float b, float a = 1.0f);
+
+// A byte range of a run's text drawn in its own color
+struct ColorSpan {
+    uint32_t begin, end;
+    uint32_t rgba;
+};
+
+// Parses "#rrggbb" or "#rrggbbaa" into GlyphInstance::rgba; 0 if malformed
+uint32_t parse_rgba(const std::string& text);
+
+// An untextured rectangle in screen pixels, with corners rounded by `radius`.
+// It is marked by an atlas rectangle with s0 > s1, which no glyph has; the
+// shaders fill it solid, and t0 carries the radius in 1/8 pixels.
+GlyphInstance solid_quad(float x, float y, float w, float h, uint32_t rgba, float radius = 0.0f);
+
+// Retained glyph instances for the whole overlay, drawn with a single
+// instanced draw call. Text is split into runs (one per widget); a run's
+// glyphs are only laid out again when its text, position or color changes,
+// and the batch is only uploaded when something did, so an unchanged frame
+// only needs draw(). Digits sit in fixed slots, so text that only changes in
+// its digits (a refreshed number) is patched by copying a precomputed quad
+// into each changed digit's instance, without layout or atlas lookups.
+class TextBatch {
+public:
+    static constexpr int VERTICES_PER_GLYPH = 4; // Triangle strip, expanded in the vertex shader
+    // Room for a few hundred glyphs so typical overlays never reallocate
+    static constexpr size_t INITIAL_GLYPH_CAPACITY = 512;
+    static constexpr size_t INITIAL_BYTES = INITIAL_GLYPH_CAPACITY * sizeof(GlyphInstance);
+
+    static constexpr float SIZE_UNITS = 8.0f;    // GlyphInstance::w/h per pixel
+
+    // `font_size` is the height text is drawn at with scale 1, in pixels
+    TextBatch(float font_size, float line_height) : font_size(font_size), line_height(line_height) {}
+
+    // Adds an empty run and returns its id
+    int add_run();
+    // Sets a run's UTF-8 text, anchored at (x, y) and `scale` times the base
+    // font size; '\n' starts a new line. Marks the run dirty only if something
+    // actually changed.
+    void set_text(int run, const char* text, float x, float y, float scale = 1.0f);
+    void set_color(int run, uint32_t rgba);
+    // Colors parts of a run's text differently from set_color(); spans are
+    // byte ranges of the text, sorted and not overlapping. Set them before
+    // the text they refer to.
+    void set_spans(int run, const ColorSpan* spans, size_t count);
+    // Which point of the run's text block lands on its anchor: 0 is the left
+    // (top) edge, 0.5 the center, 1 the right (bottom) edge. Each line is
+    // aligned on its own. Defaults to the top-left corner.
+    void set_align(int run, float align_x, float align_y);
+    // Draws a panel of `rgba` behind everything, `padding` pixels larger
+    // than the laid out text and shapes, with corners rounded by `radius`.
+    // Its size follows the measured text rather than the glyphs, so changing
+    // digits don't make it twitch. Alpha 0 disables it.
+    void set_background(uint32_t rgba, float padding, float radius);
+    // Replaces a run's contents with ready-made instances, such as
+    // solid_quad()s, drawn in the same batch as the text
+    void set_quads(int run, const GlyphInstance* quads, size_t count);
+
+    // Screen-space rectangle covered by everything drawn, valid after update()
+    float min_x = 0.0f, min_y = 0.0f, max_x = 0.0f, max_y = 0.0f;
+
+    // Rebuilds dirty runs (all of them if the atlas repacked); no GL calls.
+    // New characters are added to the atlas. Returns whether anything changed.
+    bool update(FontAtlas& atlas);
+    // Bumped by every update() that changed something, so each stream the
+    // batch is written to can tell when it is out of date
+    unsigned revision() const { return batch_revision; }
+    // Copies the instances into `stream` and returns the byte offset they
+    // landed at, where the VAO's per-instance attributes must point
+    size_t write(StreamBuffer& stream) const;
+    // Draws everything with `vao`
+    void draw(GLuint vao) const;
+    // Benchmark baseline for OVERLAY_BENCH=per_glyph, the loop the batch
+    // replaced: one glBufferSubData and one draw call per glyph. `vao` must
+    // read its instance attributes from offset 0 of `glyph_vbo`, which holds one glyph.
+    void draw_per_glyph(GLuint vao, GLuint glyph_vbo) const;
+
+private:
+    struct DigitSlot {
+        uint32_t byte;      // Position in the text
+        uint32_t instance;  // Relative to the run's first instance
+        float pen_x, baseline;
+    };
+
+    struct TextRun {
+        std::string text;
+        float x = 0.0f, y = 0.0f;
+        float scale = 1.0f;
+        float align_x = 0.0f, align_y = 0.0f;
+        uint32_t rgba = 0xFFFFFFFF;
+        std::vector<ColorSpan> spans;
+        size_t first = 0; // Index of the run's glyphs in `instances`
+        size_t count = 0;
+        bool dirty = true;
+        bool has_quads = false; // Holds `quads` instead of text
+        std::vector<GlyphInstance> quads;
+        // Laid out extent: measured lines for text, the quads otherwise; empty when x0 >= x1
+        float box_x0 = 0.0f, box_y0 = 0.0f, box_x1 = 0.0f, box_y1 = 0.0f;
+
+        // Measured size, reused while the text only differs in its digits
+        std::string measured_text;
+        float measured_scale = 0.0f;
+        std::vector<float> line_widths;
+        float height = 0.0f;
+
+        // Where each digit of the laid out text is, and the instance for
+        // every digit with the pen at the origin, for patch_digits()
+        std::vector<DigitSlot> digit_slots;
+        GlyphInstance digit_quads[10];
+        bool digits_patchable = false;
+    };
+
+    void measure(FontAtlas& atlas, TextRun& run);
+    bool patch_digits(TextRun& run, const char* text);
+    static uint32_t color_at(const TextRun& run, uint32_t byte);
+    void layout(FontAtlas& atlas, TextRun& run, std::vector<GlyphInstance>& out);
+    void compute_bounds(); // Also places the background panel
+
+    float font_size;
+    float line_height;
+    std::vector<TextRun> runs;
+    std::vector<GlyphInstance> instances;
+    std::vector<GlyphInstance> scratch;
+    // Background panel, instances[0] while enabled
+    uint32_t background_rgba = 0;
+    float background_padding = 0.0f, background_radius = 0.0f;
+    bool background_changed = false;
+    bool any_dirty = false;
+    unsigned batch_revision = 0;
+    unsigned atlas_generation = 0; // Atlas layout the instances were built against
+};
+
+#endif // TEXT_BATCH_HPP
@@ -0,0 +1,101 @@
+#include "trace_export.hpp"
+#include "telemetry_log.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+
+// Track ids inside the single exported process
+static constexpr int TRACE_PID = 1;
+static constexpr int RENDER_TID = 1;
+static constexpr int GPU_TID = 2;
+
+// Trace timestamps are microseconds; log timestamps are steady_clock (CLOCK_MONOTONIC)
+// nanoseconds, the same clock perf/Perfetto use, so traces line up as-is
+static double to_us(double ns) {
+    return ns / 1000.0;
+}
+
+// Slice bounds are kept in integer nanoseconds and printed exactly, so a
+// slice clamped to its frame's end also ends there in the file
+static void print_us(FILE* out, uint64_t ns) {
+    fprintf(out, "%llu.%03u", (unsigned long long)(ns / 1000), (unsigned)(ns % 1000));
+}
+
+static uint64_t ms_to_ns(float ms) {
+    return ms > 0.0f ? (uint64_t)((double)ms * 1e6 + 0.5) : 0;
+}
+
+// Opens a complete event; the caller adds any args and closes it
+static void begin_slice(FILE* out, const char* name, int tid, uint64_t start_ns, uint64_t end_ns) {
+    fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":%d,\"tid\":%d,\"ts\":", name, TRACE_PID, tid);
+    print_us(out, start_ns);
+    fprintf(out, ",\"dur\":");
+    print_us(out, end_ns - start_ns);
+}
+
+static void write_slice(FILE* out, const char* name, int tid, uint64_t start_ns, uint64_t end_ns) {
+    begin_slice(out, name, tid, start_ns, end_ns);
+    fprintf(out, "}");
+}
+
+bool export_chrome_trace(const std::string& log_path, const std::string& json_path) {
+    TelemetryReader reader;
+    if (!reader.open(log_path)) {
+        std::cerr << "Overlay Error: Could not read telemetry log " << log_path << std::endl;
+        return false;
+    }
+    FILE* out = fopen(json_path.c_str(), "w");
+    if (!out) {
+        std::cerr << "Overlay Error: Could not create trace file " << json_path << std::endl;
+        return false;
+    }
+
+    // Metadata names the process and tracks; every later event starts with a comma
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    fprintf(out, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"Overlay capture\"}}", TRACE_PID);
+    fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"Render thread\"}}", TRACE_PID, RENDER_TID);
+    fprintf(out, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":\"GPU\"}}", TRACE_PID, GPU_TID);
+
+    const std::vector<SchemaEntry>& schema = reader.schema();
+    size_t frames = 0;
+    TelemetryReader::Record record;
+    while (reader.next(record)) {
+        if (record.type == RECORD_SAMPLE) {
+            const LogSample& s = record.sample;
+            const char* name = "unknown";
+            for (const SchemaEntry& entry : schema) {
+                if (entry.id == s.metric) name = entry.name;
+            }
+            fprintf(out, ",\n{\"name\":\"%s\",\"ph\":\"C\",\"pid\":%d,\"ts\":%.3f,\"args\":{\"value\":%.3f}}",
+                    name, TRACE_PID, to_us(s.timestamp_ns), s.value);
+            continue;
+        }
+
+        // A frame runs from the previous swap returning to this one returning.
+        // The CPU slices nest inside it, clamped so float rounding in the
+        // log can't push one past its frame's edges or into each other.
+        const FrameRecord& f = record.frame.frame;
+        uint64_t end_ns = f.timestamp_ns;
+        uint64_t start_ns = end_ns - std::min(end_ns, ms_to_ns(f.frame_ms));
+        begin_slice(out, "Frame", RENDER_TID, start_ns, end_ns);
+        fprintf(out, ",\"args\":{\"frame\":%zu,\"frame_ms\":%.3f,\"app_cpu_ms\":%.3f,\"present_wait_ms\":%.3f,\"gpu_ms\":%.3f}}",
+                frames, f.frame_ms, f.app_cpu_ms, f.present_wait_ms, f.gpu_ms);
+        uint64_t app_end_ns = std::min(end_ns, start_ns + ms_to_ns(f.app_cpu_ms));
+        write_slice(out, "App CPU", RENDER_TID, start_ns, app_end_ns);
+        write_slice(out, "Present wait", RENDER_TID, std::max(app_end_ns, end_ns - std::min(end_ns, ms_to_ns(f.present_wait_ms))), end_ns);
+        // GPU work overlaps the CPU slices, so it can't nest on the render track
+        if (f.gpu_ms > 0.0f) write_slice(out, "GPU", GPU_TID, start_ns, start_ns + ms_to_ns(f.gpu_ms));
+        if (record.frame.flags & FRAME_FLAG_STUTTER) {
+            fprintf(out, ",\n{\"name\":\"Stutter\",\"ph\":\"i\",\"s\":\"t\",\"pid\":%d,\"tid\":%d,\"ts\":",
+                    TRACE_PID, RENDER_TID);
+            print_us(out, end_ns);
+            fprintf(out, "}");
+        }
+        frames++;
+    }
+    fprintf(out, "\n]}\n");
+    bool ok = !ferror(out);
+    ok = fclose(out) == 0 && ok;
+    if (ok) std::cout << "Overlay: Exported " << frames << " frames to " << json_path << std::endl;
+    return ok;
+}
@@ -0,0 +1,14 @@
+#ifndef TRACE_EXPORT_HPP
+#define TRACE_EXPORT_HPP
+
+#include <string>
+
+// Converts a telemetry log into Chrome trace event JSON (loadable in
+// ui.perfetto.dev and chrome://tracing). Frames become slices on a render
+// thread track with app CPU time and present wait nested inside; GPU time gets
+// its own track and every collector metric becomes a counter track.
+// Records are streamed straight from the log to the output, so captures of
+// any length can be converted in constant memory.
+bool export_chrome_trace(const std::string& log_path, const std::string& json_path);
+
+#endif // TRACE_EXPORT_HPP